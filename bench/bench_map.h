@@ -0,0 +1,39 @@
+// Map and random number fixtures shared by the benchmarks and the golden test, so every tool
+// measures the same maps and draws the same numbers from one run to the next
+#pragma once
+
+#include <vector>
+
+// Build a size x size map with a solid border. Cluttered maps scatter walls over about 30% of
+// the interior; the 3x3 centre is always kept clear for the player. The goldens depend on this
+// exact sequence, so changing it means regenerating them.
+inline std::vector<int> makeMap(int size, bool cluttered)
+{
+    std::vector<int> tiles(size * size, 0);
+    unsigned seed = 12345u;
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            seed = seed * 1664525u + 1013904223u;
+            if (border)
+                tiles[y * size + x] = 1;
+            else if (cluttered && (seed >> 8) % 100 < 30)
+                tiles[y * size + x] = 1 + (seed >> 20) % 3;
+        }
+    }
+    int centre = size / 2;
+    for (int y = centre - 1; y <= centre + 1; ++y)
+        for (int x = centre - 1; x <= centre + 1; ++x)
+            tiles[y * size + x] = 0;
+    return tiles;
+}
+
+// Uniform in 0..1, from a fixed seed
+inline float randomUnit()
+{
+    static unsigned seed = 987654321u;
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
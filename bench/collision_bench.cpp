@@ -0,0 +1,159 @@
+// Benchmark of batched circle-vs-grid collision: many bodies wander a cluttered map, turning
+// whenever a wall stops them. Reports the cost per body and per tick, and fails if any body ends
+// a tick overlapping a wall or in a different open region than it started in.
+#include "bench_map.h"
+#include "collision.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Label every open cell with its 4-connected region. A body can't squeeze between two cells
+// that only touch at a corner, so it must stay in the region it starts in.
+static std::vector<int> labelRegions()
+{
+    std::vector<int> region(mapArray.size(), -1);
+    std::vector<int> stack;
+    int regions = 0;
+    for (int start = 0; start < mp * mp; ++start)
+    {
+        if (region[start] >= 0 || blocksMovement(start))
+            continue;
+        region[start] = regions;
+        stack.push_back(start);
+        while (!stack.empty())
+        {
+            int cell = stack.back();
+            stack.pop_back();
+            int x = cell % mp, y = cell / mp;
+            const int next[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+            for (const auto& n : next)
+            {
+                if (n[0] < 0 || n[0] >= mp || n[1] < 0 || n[1] >= mp)
+                    continue;
+                int neighbour = n[1] * mp + n[0];
+                if (region[neighbour] < 0 && !blocksMovement(neighbour)) {
+                    region[neighbour] = regions;
+                    stack.push_back(neighbour);
+                }
+            }
+        }
+        ++regions;
+    }
+    return region;
+}
+
+static int cellAt(float x, float y)
+{
+    return int(mp - y / sq) * mp + int(x / sq);
+}
+
+// How far a body reaches into the blocking cells around it, 0 if it's clear of them
+static float penetration(float x, float y, float radius)
+{
+    float deepest = 0.0f;
+    for (int row = int(std::floor((y - radius) / sq)); row <= int(std::floor((y + radius) / sq)); ++row)
+    {
+        for (int column = int(std::floor((x - radius) / sq)); column <= int(std::floor((x + radius) / sq)); ++column)
+        {
+            int grid_y = mp - 1 - row;
+            if (column >= 0 && column < mp && grid_y >= 0 && grid_y < mp && !blocksMovement(grid_y * mp + column))
+                continue;
+            float awayX = x - std::clamp(x, float(column * sq), float(column * sq + sq));
+            float awayY = y - std::clamp(y, float(row * sq), float(row * sq + sq));
+            deepest = std::max(deepest, radius - std::sqrt(awayX * awayX + awayY * awayY));
+        }
+    }
+    return deepest;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 100000;
+    int ticks = 600;
+    int mapSize = 512;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bodies") == 0 && i + 1 < argc)
+            count = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+            ticks = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+            mapSize = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--bodies N] [--ticks N] [--map size]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    loadMap(mapSize, makeMap(mapSize, true));
+    std::vector<int> region = labelRegions();
+    std::vector<int> openCells;
+    for (int cell = 0; cell < mp * mp; ++cell)
+        if (region[cell] >= 0)
+            openCells.push_back(cell);
+
+    // Bodies start at open cell centres with radii from 4 to 24. Most walk at up to 4 units per
+    // tick; one in a hundred moves 3 cells per tick, to check that fast bodies don't tunnel.
+    std::vector<float> x(count), y(count), dx(count), dy(count), radius(count), speed(count), heading(count);
+    std::vector<int> startRegion(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int cell = openCells[size_t(randomUnit() * openCells.size()) % openCells.size()];
+        x[i] = (cell % mp + 0.5f) * sq;
+        y[i] = (mp - 1 - cell / mp + 0.5f) * sq;
+        radius[i] = 4.0f + 20.0f * randomUnit();
+        speed[i] = i % 100 == 0 ? 3.0f * sq : 0.5f + 3.5f * randomUnit();
+        heading[i] = 2.0f * float(M_PI) * randomUnit();
+        startRegion[i] = region[cell];
+    }
+
+    using clock = std::chrono::steady_clock;
+    double seconds = 0.0, worstTick = 0.0;
+    long long stopped = 0, overlaps = 0, escapes = 0;
+    float deepest = 0.0f;
+    std::vector<float> wantX(count), wantY(count);
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dx[i] = speed[i] * std::cos(heading[i]);
+            dy[i] = speed[i] * std::sin(heading[i]);
+            wantX[i] = x[i] + dx[i];
+            wantY[i] = y[i] + dy[i];
+        }
+
+        auto start = clock::now();
+        moveCircles(x.data(), y.data(), dx.data(), dy.data(), radius.data(), count);
+        double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        seconds += elapsed;
+        worstTick = std::max(worstTick, elapsed);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Turn bodies that something got in the way of, so they keep running into walls
+            float shortX = wantX[i] - x[i], shortY = wantY[i] - y[i];
+            if (shortX * shortX + shortY * shortY > 0.01f * speed[i] * speed[i]) {
+                heading[i] = 2.0f * float(M_PI) * randomUnit();
+                ++stopped;
+            }
+            float depth = penetration(x[i], y[i], std::clamp(radius[i], minBodyRadius, maxBodyRadius));
+            deepest = std::max(deepest, depth);
+            if (depth > 0.01f)
+                ++overlaps;
+            if (region[cellAt(x[i], y[i])] != startRegion[i])
+                ++escapes;
+        }
+    }
+
+    double bodyTicks = double(count) * ticks;
+    std::printf("map %d cluttered, %zu bodies, %d ticks\n", mapSize, count, ticks);
+    std::printf("  %.1f ns per body per tick, %.3f ms per tick (worst %.3f ms)\n",
+                seconds * 1e9 / bodyTicks, seconds * 1e3 / ticks, worstTick * 1e3);
+    std::printf("  %.1f%% of moves blocked or deflected\n", 100.0 * stopped / bodyTicks);
+    std::printf("  %lld overlapping a wall (deepest %.4f), %lld left their region\n", overlaps, deepest, escapes);
+    return overlaps == 0 && escapes == 0 ? 0 : 1;
+}
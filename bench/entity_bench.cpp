@@ -0,0 +1,174 @@
+// Benchmark of the entity store on one core: many entities wander a cluttered map, steering away
+// from the neighbours the spatial hash finds, while a few are removed and spawned each tick and
+// a camera culls the ones in view. Reports the cost of each part of a tick and fails if the hash
+// ever disagrees with a brute-force search.
+#include "bench_map.h"
+#include "entities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static std::vector<int> openCells;
+
+// Spawn a wandering entity at the centre of a random open cell
+static void spawnWanderer(EntityStore& store)
+{
+    int cell = openCells[size_t(randomUnit() * openCells.size()) % openCells.size()];
+    float heading = 2.0f * float(M_PI) * randomUnit();
+    spawnEntity(store, (cell % mp + 0.5f) * sq, (mp - 1 - cell / mp + 0.5f) * sq, heading,
+                std::cos(heading), std::sin(heading), 6.0f + 10.0f * randomUnit(), uint16_t(randomUnit() * 8));
+}
+
+// True if every entity is filed once, under the cell it stands in
+static bool hashConsistent(const EntityStore& store)
+{
+    std::vector<int> seen(store.size(), 0);
+    for (int head : store.bucketHead)
+    {
+        for (int e = head, before = -1; e >= 0; before = e, e = store.next[e])
+        {
+            if (store.prev[e] != before || ++seen[e] > 1)
+                return false;
+        }
+    }
+    for (size_t i = 0; i < store.size(); ++i)
+        if (!seen[i] || store.cell[i] != entityCell(store.x[i], store.y[i]))
+            return false;
+    return true;
+}
+
+// True if queryEntities() finds exactly what checking every entity finds
+static bool queryMatchesBruteForce(const EntityStore& store, float x, float y, float distance)
+{
+    std::vector<int> found, expected;
+    queryEntities(store, x, y, distance, found);
+    for (size_t i = 0; i < store.size(); ++i)
+    {
+        float dx = store.x[i] - x, dy = store.y[i] - y, within = distance + store.radius[i];
+        if (dx * dx + dy * dy < within * within)
+            expected.push_back(int(i));
+    }
+    std::sort(found.begin(), found.end());
+    return found == expected;
+}
+
+int main(int argc, char** argv)
+{
+    int count = 100000;
+    int ticks = 600;
+    int mapSize = 512;
+    int thinkEvery = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--entities") == 0 && i + 1 < argc)
+            count = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+            ticks = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+            mapSize = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--think-every") == 0 && i + 1 < argc)
+            thinkEvery = std::max(std::atoi(argv[++i]), 1);
+        else {
+            std::fprintf(stderr, "usage: %s [--entities N] [--ticks N] [--map size] [--think-every N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    loadMap(mapSize, makeMap(mapSize, true));
+    initDoors();
+    setFieldOfView(defaultFieldOfView);
+    for (int cell = 0; cell < mp * mp; ++cell)
+        if (!blocksMovement(cell))
+            openCells.push_back(cell);
+
+    EntityStore store;
+    for (int i = 0; i < count; ++i)
+        spawnWanderer(store);
+
+    // Entities walk at 1 unit per tick. When one thinks, it steers away from anything within 24
+    // units of it, or else turns a little at random; with --think-every N each thinks on one tick
+    // in N, staggered across the ticks. Nothing is drawn, so headings are left as spawned. A camera
+    // circles the middle of the map. A tick has to fit in 1/60 s to keep up with the simulation.
+    const int targetTicksPerSecond = 60;
+    const float neighbourDistance = 24.0f;
+    const int churn = 100; // Entities removed and spawned each tick
+    using clock = std::chrono::steady_clock;
+    double aiSeconds = 0.0, stepSeconds = 0.0, churnSeconds = 0.0, cullSeconds = 0.0, worstTick = 0.0;
+    long long queries = 0, neighbours = 0, visible = 0;
+    bool consistent = true;
+    std::vector<int> found;
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        auto start = clock::now();
+        for (size_t i = tick % thinkEvery; i < store.size(); i += thinkEvery)
+        {
+            queryEntities(store, store.x[i], store.y[i], neighbourDistance, found);
+            ++queries;
+            neighbours += found.size() - 1;
+            float awayX = 0.0f, awayY = 0.0f;
+            for (int other : found)
+            {
+                awayX += store.x[i] - store.x[other];
+                awayY += store.y[i] - store.y[other];
+            }
+            // Steer by turning the velocity itself, so thinking takes no trig
+            float vx = store.vx[i], vy = store.vy[i];
+            if (awayX != 0.0f || awayY != 0.0f) {
+                vx = awayX;
+                vy = awayY;
+            } else {
+                float turn = 0.2f * (randomUnit() - 0.5f);
+                float turnedX = vx - vy * turn, turnedY = vy + vx * turn;
+                vx = turnedX;
+                vy = turnedY;
+            }
+            float scale = 1.0f / std::sqrt(vx * vx + vy * vy);
+            store.vx[i] = vx * scale;
+            store.vy[i] = vy * scale;
+        }
+        auto ai = clock::now();
+
+        stepEntities(store);
+        auto step = clock::now();
+
+        for (int i = 0; i < churn; ++i)
+        {
+            removeEntity(store, int(randomUnit() * store.size()) % int(store.size()));
+            spawnWanderer(store);
+        }
+        auto churned = clock::now();
+
+        float angle = tick * 0.01f;
+        Pose camera = {(mp * 0.5f + 4.0f * std::cos(angle)) * sq, (mp * 0.5f + 4.0f * std::sin(angle)) * sq, angle};
+        cullEntities(store, camera, 16.0f * sq, found);
+        visible += found.size();
+        auto culled = clock::now();
+
+        aiSeconds += std::chrono::duration<double>(ai - start).count();
+        stepSeconds += std::chrono::duration<double>(step - ai).count();
+        churnSeconds += std::chrono::duration<double>(churned - step).count();
+        cullSeconds += std::chrono::duration<double>(culled - churned).count();
+        worstTick = std::max(worstTick, std::chrono::duration<double>(culled - start).count());
+
+        // Check the hash against brute force now and then, outside the timings
+        if (tick % 60 == 0 || tick == ticks - 1) {
+            consistent = consistent && hashConsistent(store);
+            for (int q = 0; q < 16 && consistent; ++q)
+                consistent = queryMatchesBruteForce(store, randomUnit() * mp * sq, randomUnit() * mp * sq, 4.0f * sq * randomUnit());
+        }
+    }
+
+    double total = aiSeconds + stepSeconds + churnSeconds + cullSeconds;
+    std::printf("map %d cluttered, %zu entities, %d ticks, each thinking every %d\n", mapSize, store.size(), ticks, thinkEvery);
+    std::printf("  %.3f ms per tick (worst %.3f ms), %.0f ticks/s on one core, target %d\n",
+                total * 1e3 / ticks, worstTick * 1e3, ticks / total, targetTicksPerSecond);
+    std::printf("  thinking %.3f ms, move and refile %.3f ms, %d removes and spawns %.3f ms, view cull %.3f ms\n",
+                aiSeconds * 1e3 / ticks, stepSeconds * 1e3 / ticks, churn, churnSeconds * 1e3 / ticks, cullSeconds * 1e3 / ticks);
+    std::printf("  %.1f ns per neighbour query with its steering, %.2f neighbours each, %.0f entities in view\n",
+                aiSeconds * 1e9 / queries, double(neighbours) / queries, double(visible) / ticks);
+    std::printf("  hash %s\n", consistent ? "matches brute force" : "DISAGREES with brute force");
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+// Microbenchmarks for the cast, projection and rectangle mesh building stages. The mesh stage
+// appends rectangles the way the projection does, into a mesh reserved up front.
+// Sweeps the slice count, map size and map clutter and prints results as JSON.
+#include "bench_map.h"
+#include "minimap.h"
+#include "raycast.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+
+// Count every heap allocation so each stage can report allocations per frame
+static std::atomic<long long> allocationCount{0};
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Holds the measurements for one stage in one configuration
+struct BenchResult {
+    std::string stage;
+    int slices;
+    int mapSize;
+    const char* layout;
+    long long frames;
+    double nsPerRay;
+    double raysPerSecond;
+    double allocsPerFrame;
+};
+
+// Place the player in the middle of the map facing one of 8 directions
+static void setPose(int pose)
+{
+    playerX = (mp / 2 + 0.5f) * sq;
+    playerY = (mp / 2 + 0.5f) * sq;
+    rotation = pose * (2.0f * M_PI / 8.0f) + 0.01f;
+}
+
+// Run one frame of a stage repeatedly across the 8 poses until enough time has passed
+static BenchResult measure(const char* stage, const char* layout, double minSeconds,
+                           const std::function<void(int)>& frame)
+{
+    using clock = std::chrono::steady_clock;
+
+    frame(0); // Warm up caches and any lazily sized buffers
+
+    long long frames = 0;
+    long long allocsBefore = allocationCount.load();
+    auto start = clock::now();
+    double elapsed = 0.0;
+    while (frames < 3 || (elapsed < minSeconds && frames < 1000))
+    {
+        frame(static_cast<int>(frames % 8));
+        ++frames;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    long long allocs = allocationCount.load() - allocsBefore;
+
+    BenchResult result;
+    result.stage = stage;
+    result.slices = numSlices;
+    result.mapSize = mp;
+    result.layout = layout;
+    result.frames = frames;
+    result.nsPerRay = elapsed * 1e9 / (double(frames) * numSlices);
+    result.raysPerSecond = 1e9 / result.nsPerRay;
+    result.allocsPerFrame = double(allocs) / frames;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [--quick] [--out results.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<int> sliceCounts = quick ? std::vector<int>{128, 2048}
+                                         : std::vector<int>{128, 512, 2048, 8192, 16384};
+    std::vector<int> mapSizes = quick ? std::vector<int>{8, 64} : std::vector<int>{8, 64, 512, 4096};
+    double minSeconds = quick ? 0.05 : 0.25;
+
+    initShading();
+
+    std::vector<BenchResult> results;
+    for (int mapSize : mapSizes)
+    {
+        for (bool cluttered : {false, true})
+        {
+            const char* layout = cluttered ? "cluttered" : "open";
+            loadMap(mapSize, makeMap(mapSize, cluttered));
+
+            // The minimap is meshed once per map, so it's reported on its own rather than per ray
+            auto meshStart = std::chrono::steady_clock::now();
+            MinimapMesh minimap;
+            buildMinimapMesh(minimap, doors);
+            double meshMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+            std::fprintf(stderr, "map %4d %-9s minimap %9d quads for %9d cells in %8.2f ms\n",
+                         mapSize, layout, minimap.quads, mapSize * mapSize, meshMs);
+
+            for (int slices : sliceCounts)
+            {
+                numSlices = slices;
+
+                // Cast results per pose, reused as input to the projection stage
+                std::vector<std::vector<RayInfo>> hits(8);
+                for (int pose = 0; pose < 8; ++pose)
+                {
+                    setPose(pose);
+                    hits[pose] = generateRayLinesAndDistances().hitInfo;
+                }
+
+                results.push_back(measure("cast", layout, minSeconds, [](int pose) {
+                    setPose(pose);
+                    RayLinesResult cast = generateRayLinesAndDistances();
+                    if (cast.hitInfo.empty()) std::abort();
+                }));
+
+                results.push_back(measure("projection", layout, minSeconds, [&](int pose) {
+                    VerticesIndices projection = generateProjectionInfo(hits[pose]);
+                    if (projection.indices.empty()) std::abort();
+                }));
+
+                // The rectangle building the projection does, appending into a reserved mesh,
+                // without the shading work
+                results.push_back(measure("mesh", layout, minSeconds, [](int) {
+                    const int rects = numSlices * texSize;
+                    const float rgb[3] = {1.0f, 1.0f, 1.0f};
+                    VerticesIndices mesh;
+                    mesh.vertices.reserve(size_t(rects) * 24);
+                    mesh.indices.reserve(size_t(rects) * 6);
+                    for (int i = 0; i < rects; ++i)
+                        appendRect(mesh, -1.0f, 1.0f, -1.0f, 1.0f, rgb);
+                    if (mesh.indices.empty()) std::abort();
+                }));
+
+                const BenchResult* last = &results.back() - 2;
+                std::fprintf(stderr, "map %4d %-9s slices %5d  cast %8.1f ns/ray  projection %8.1f ns/ray  mesh %8.1f ns/ray\n",
+                             mapSize, layout, slices, last[0].nsPerRay, last[1].nsPerRay, last[2].nsPerRay);
+            }
+        }
+    }
+
+    FILE* out = outPath ? std::fopen(outPath, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "could not open %s\n", outPath);
+        return 1;
+    }
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    std::fprintf(out, "{\n  \"build\": \"%s\",\n  \"benchmarks\": [\n", build);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        std::fprintf(out,
+                     "    {\"stage\": \"%s\", \"slices\": %d, \"map_size\": %d, \"map\": \"%s\", \"frames\": %lld, "
+                     "\"ns_per_ray\": %.3f, \"rays_per_s\": %.0f, \"allocs_per_frame\": %.1f}%s\n",
+                     r.stage.c_str(), r.slices, r.mapSize, r.layout, r.frames,
+                     r.nsPerRay, r.raysPerSecond, r.allocsPerFrame, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+    if (outPath)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,299 @@
+// Golden regression check for the cast and projection. Renders a fixed set of camera poses on
+// several maps headlessly, compares per-column distance, tile and side and a software raster of
+// the projection against stored goldens, and records the frame cost next to the result.
+#include "bench_map.h"
+#include "game.h"
+#include "lightmap.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Holds one camera pose on one map and view mode
+struct GoldenScene {
+    const char* name;
+    const char* map;   // "default", "open16" or "cluttered64"
+    bool sectors;
+    bool terrain;
+    float x, y, rotation;
+};
+
+static const GoldenScene scenes[] = {
+    {"default_start",      "default",     false, false, 256.0f,  256.0f,  1.5808f},
+    {"default_door",       "default",     false, false, 96.0f,   288.0f,  1.5808f},
+    {"default_thin",       "default",     false, false, 288.0f,  160.0f,  3.19f},
+    {"default_corner",     "default",     false, false, 400.0f,  400.0f,  3.9f},
+    {"open16_east",        "open16",      false, false, 544.0f,  544.0f,  0.01f},
+    {"open16_northwest",   "open16",      false, false, 544.0f,  544.0f,  2.2f},
+    {"open16_south",       "open16",      false, false, 544.0f,  544.0f,  4.0f},
+    {"cluttered64_east",   "cluttered64", false, false, 2080.0f, 2080.0f, 0.01f},
+    {"cluttered64_north",  "cluttered64", false, false, 2080.0f, 2080.0f, 1.9f},
+    {"cluttered64_west",   "cluttered64", false, false, 2080.0f, 2080.0f, 3.7f},
+    {"cluttered64_south",  "cluttered64", false, false, 2080.0f, 2080.0f, 5.5f},
+    {"sectors_hall",       "default",     true,  false, 256.0f,  256.0f,  1.5808f},
+    {"sectors_south_room", "default",     true,  false, 256.0f,  120.0f,  1.2f},
+    {"sectors_wing",       "default",     true,  false, 410.0f,  330.0f,  3.3f},
+    {"terrain_east",       "default",     false, true,  256.0f,  256.0f,  0.01f},
+    {"terrain_north",      "default",     false, true,  256.0f,  256.0f,  2.0f}
+};
+
+// Slices cast for every scene, and the size of the projection raster compared as an image
+const int goldenSlices = 128;
+const int imageWidth = 128;
+const int imageHeight = 128;
+
+// Tolerances. Distances may drift by a fraction of a pixel; tile and side may only differ on
+// columns next to an edge in the golden, where a corner hit can legitimately go either way.
+// Pixels may differ by a few levels, and a small share may differ outright where an edge moved.
+const float distanceTolerance = 0.05f;         // Absolute, in pixels
+const float distanceRelativeTolerance = 0.002f;
+const int channelTolerance = 8;
+const float pixelMismatchShare = 0.005f;
+
+// Holds what is compared for one column
+struct GoldenColumn {
+    float distance;
+    int tile;
+    int face;
+    int hitEW;
+};
+
+// Holds a scene's golden data
+struct GoldenData {
+    double frameNs = 0.0;
+    std::vector<GoldenColumn> columns;
+    std::vector<unsigned char> image; // imageWidth * imageHeight RGB
+};
+
+// Fill the rectangles of a projection mesh into an RGB raster of the projection.
+// Every projection quad is axis aligned, so each group of 4 vertices is treated as a rectangle.
+static std::vector<unsigned char> rasterize(const VerticesIndices& mesh)
+{
+    std::vector<unsigned char> image(imageWidth * imageHeight * 3, 0);
+    for (size_t v = 0; v + 24 <= mesh.vertices.size(); v += 24)
+    {
+        const float* quad = &mesh.vertices[v];
+        float lX = std::min(quad[0], quad[6]), rX = std::max(quad[0], quad[6]);
+        float bY = std::min(quad[1], quad[13]), tY = std::max(quad[1], quad[13]);
+
+        // The mesh fills the projection's viewport, NDC -1..1 on both axes; row 0 is the top
+        int x0 = std::max(0, int(std::ceil((lX + 1.0f) * 0.5f * imageWidth - 0.5f)));
+        int x1 = std::min(imageWidth, int(std::ceil((rX + 1.0f) * 0.5f * imageWidth - 0.5f)));
+        int y0 = std::max(0, int(std::ceil((1.0f - tY) * 0.5f * imageHeight - 0.5f)));
+        int y1 = std::min(imageHeight, int(std::ceil((1.0f - bY) * 0.5f * imageHeight - 0.5f)));
+        unsigned char rgb[3];
+        for (int c = 0; c < 3; ++c)
+            rgb[c] = static_cast<unsigned char>(std::clamp(quad[3 + c], 0.0f, 1.0f) * 255.0f + 0.5f);
+        for (int y = y0; y < y1; ++y)
+            for (int x = x0; x < x1; ++x)
+                std::memcpy(&image[(y * imageWidth + x) * 3], rgb, 3);
+    }
+    return image;
+}
+
+static bool readGolden(const std::string& dir, const char* scene, GoldenData& golden)
+{
+    std::ifstream text(dir + "/" + scene + ".txt");
+    std::ifstream ppm(dir + "/" + scene + ".ppm", std::ios::binary);
+    if (!text || !ppm)
+        return false;
+
+    std::string line, key;
+    while (std::getline(text, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        if (line.compare(0, 8, "frame_ns") == 0) {
+            fields >> key >> golden.frameNs;
+            continue;
+        }
+        int column;
+        GoldenColumn c;
+        if (fields >> column >> c.distance >> c.tile >> c.face >> c.hitEW)
+            golden.columns.push_back(c);
+    }
+
+    std::string magic;
+    int width, height, maxValue;
+    ppm >> magic >> width >> height >> maxValue;
+    ppm.get();
+    if (magic != "P6" || width != imageWidth || height != imageHeight || maxValue != 255)
+        return false;
+    golden.image.resize(imageWidth * imageHeight * 3);
+    ppm.read(reinterpret_cast<char*>(golden.image.data()), golden.image.size());
+    return static_cast<bool>(ppm);
+}
+
+static bool writeGolden(const std::string& dir, const char* scene, const GoldenData& golden)
+{
+    FILE* text = std::fopen((dir + "/" + scene + ".txt").c_str(), "w");
+    FILE* ppm = std::fopen((dir + "/" + scene + ".ppm").c_str(), "wb");
+    if (!text || !ppm) {
+        if (text) std::fclose(text);
+        if (ppm) std::fclose(ppm);
+        return false;
+    }
+
+    std::fprintf(text, "# raycast_golden scene %s, %d slices\n", scene, goldenSlices);
+    std::fprintf(text, "frame_ns %.0f\n", golden.frameNs);
+    std::fprintf(text, "# column distance tile face hitEW\n");
+    for (size_t i = 0; i < golden.columns.size(); ++i)
+    {
+        const GoldenColumn& c = golden.columns[i];
+        std::fprintf(text, "%zu %.3f %d %d %d\n", i, c.distance, c.tile, c.face, c.hitEW);
+    }
+    std::fprintf(ppm, "P6\n%d %d\n255\n", imageWidth, imageHeight);
+    std::fwrite(golden.image.data(), 1, golden.image.size(), ppm);
+
+    bool ok = std::ferror(text) == 0 && std::ferror(ppm) == 0;
+    std::fclose(text);
+    std::fclose(ppm);
+    return ok;
+}
+
+// Whether column i of the golden sits next to a change of tile or side
+static bool nearEdge(const std::vector<GoldenColumn>& columns, size_t i)
+{
+    for (size_t j : {i - 1, i + 1})
+    {
+        if (j < columns.size() && (columns[j].tile != columns[i].tile || columns[j].face != columns[i].face))
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir = RAYCAST_GOLDEN_DIR;
+    bool update = false;
+    float maxSlowdown = 0.0f;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if (std::strcmp(argv[i], "--max-slowdown") == 0 && i + 1 < argc)
+            maxSlowdown = static_cast<float>(std::atof(argv[++i]));
+        else {
+            std::fprintf(stderr, "usage: %s [--update] [--dir golden_dir] [--max-slowdown factor]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    initGame();
+    numSlices = goldenSlices;
+    const int defaultSize = mp;
+    const std::vector<int> defaultMap = mapArray;
+
+    using clock = std::chrono::steady_clock;
+    std::string loadedMap;
+    int failures = 0;
+    FrameOutput frame;
+    for (const GoldenScene& scene : scenes)
+    {
+        if (loadedMap != scene.map) {
+            if (std::strcmp(scene.map, "open16") == 0)
+                loadMap(16, makeMap(16, false));
+            else if (std::strcmp(scene.map, "cluttered64") == 0)
+                loadMap(64, makeMap(64, true));
+            else
+                loadMap(defaultSize, defaultMap);
+            // Rebake the lights for the new map
+            shutdownLightmap();
+            initLightmap();
+            loadedMap = scene.map;
+        }
+        viewModes.sectors = scene.sectors;
+        viewModes.terrain = scene.terrain;
+        playerX = scene.x;
+        playerY = scene.y;
+        rotation = scene.rotation;
+
+        buildFrame(frame);
+        GoldenData result;
+        for (const RayInfo& hit : frame.rays.hitInfo)
+            result.columns.push_back({hit.distance, hit.mapHit, hit.face, hit.hitEW ? 1 : 0});
+        result.image = rasterize(frame.projection);
+
+        // Frame cost: median of repeated cast + projection builds
+        std::vector<double> samples;
+        auto start = clock::now();
+        while (samples.size() < 5 || (samples.size() < 200 && clock::now() - start < std::chrono::milliseconds(100)))
+        {
+            auto begin = clock::now();
+            buildFrame(frame);
+            samples.push_back(std::chrono::duration<double, std::nano>(clock::now() - begin).count());
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        result.frameNs = samples[samples.size() / 2];
+
+        if (update) {
+            if (!writeGolden(dir, scene.name, result)) {
+                std::fprintf(stderr, "could not write goldens for %s in %s\n", scene.name, dir.c_str());
+                return 1;
+            }
+            std::printf("%-20s updated  %9.0f ns/frame\n", scene.name, result.frameNs);
+            continue;
+        }
+
+        GoldenData golden;
+        if (!readGolden(dir, scene.name, golden) || golden.columns.size() != result.columns.size()) {
+            std::printf("%-20s FAIL  missing or malformed golden in %s\n", scene.name, dir.c_str());
+            ++failures;
+            continue;
+        }
+
+        float worstDistance = 0.0f;
+        int distanceErrors = 0, hitErrors = 0;
+        for (size_t i = 0; i < golden.columns.size(); ++i)
+        {
+            const GoldenColumn& want = golden.columns[i];
+            const GoldenColumn& got = result.columns[i];
+            float error = std::fabs(got.distance - want.distance);
+            worstDistance = std::max(worstDistance, error);
+            if (error > std::max(distanceTolerance, distanceRelativeTolerance * want.distance))
+                ++distanceErrors;
+            if ((got.tile != want.tile || got.face != want.face || got.hitEW != want.hitEW) && !nearEdge(golden.columns, i))
+                ++hitErrors;
+        }
+
+        int pixelErrors = 0;
+        for (int p = 0; p < imageWidth * imageHeight; ++p)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                if (std::abs(result.image[p * 3 + c] - golden.image[p * 3 + c]) > channelTolerance) {
+                    ++pixelErrors;
+                    break;
+                }
+            }
+        }
+        bool imageOk = pixelErrors <= pixelMismatchShare * imageWidth * imageHeight;
+
+        float slowdown = golden.frameNs > 0.0 ? static_cast<float>(result.frameNs / golden.frameNs) : 0.0f;
+        bool costOk = maxSlowdown <= 0.0f || slowdown <= maxSlowdown;
+
+        bool ok = distanceErrors == 0 && hitErrors == 0 && imageOk && costOk;
+        failures += ok ? 0 : 1;
+        std::printf("%-20s %s  max distance error %.4f, %d distance / %d hit columns off, %d pixels off, "
+                    "%9.0f ns/frame (%.2fx golden)\n",
+                    scene.name, ok ? "ok  " : "FAIL", worstDistance, distanceErrors, hitErrors, pixelErrors,
+                    result.frameNs, slowdown);
+    }
+
+    shutdownLightmap();
+    shutdownWorkers();
+
+    if (!update)
+        std::printf("%d of %zu scenes failed\n", failures, sizeof(scenes) / sizeof(scenes[0]));
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Headless replay of a recorded input log through the full simulation, cast and projection.
+// Renders one frame per simulation tick and reports frame time percentiles so builds can be
+// compared on identical input. --sim-only runs just the ticks, as fast as they go.
+#include "game.h"
+#include "input_log.h"
+#include "lightmap.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Write a scripted walk through every mode, for when no recording is at hand
+static InputLog makeDemoLog()
+{
+    struct Step { unsigned buttons; int ticks; };
+    const Step script[] = {
+        {buttonForward, 90}, {buttonTurnLeft, 50}, {buttonForward | buttonLeft, 80},
+        {buttonUse, 1}, {0, 60}, {buttonTurnRight, 120}, {buttonForward, 60},
+        {buttonLight, 1}, {buttonBack | buttonTurnLeft, 90}, {buttonTerrain, 1},
+        {buttonForward | buttonTurnRight, 180}, {buttonTerrain, 1}, {buttonSectors, 1},
+        {buttonForward, 60}, {buttonTurnLeft, 200}, {buttonSectors, 1}, {buttonForward | buttonRight, 120}
+    };
+
+    InputLog log;
+    log.startX = 256;
+    log.startY = 256;
+    log.startRotation = M_PI/2 + 0.01;
+    for (const Step& step : script)
+        log.ticks.insert(log.ticks.end(), step.ticks, static_cast<uint16_t>(step.buttons));
+    return log;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv)
+{
+    std::string logPath, demoPath, tracePath;
+    bool perfCounters = false;
+    bool simOnly = false;
+    int repeat = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--slices") == 0 && i + 1 < argc)
+            numSlices = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--perf-counters") == 0)
+            perfCounters = true;
+        else if (std::strcmp(argv[i], "--sim-only") == 0)
+            simOnly = true;
+        else if (std::strcmp(argv[i], "--write-demo") == 0 && i + 1 < argc)
+            demoPath = argv[++i];
+        else if (argv[i][0] != '-' && logPath.empty())
+            logPath = argv[i];
+        else {
+            std::fprintf(stderr, "usage: %s <input.log> [--slices N] [--repeat N] [--trace out.json] [--perf-counters] [--sim-only]\n"
+                                 "       %s --write-demo <input.log>\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (!demoPath.empty())
+        return saveInputLog(demoPath, makeDemoLog()) ? 0 : 1;
+
+    InputLog log;
+    if (logPath.empty() || !loadInputLog(logPath, log))
+        return 1;
+    // There would be no frame times to take percentiles of, nor ticks to divide by
+    if (log.ticks.empty()) {
+        std::fprintf(stderr, "%s: log has no ticks\n", logPath.c_str());
+        return 1;
+    }
+
+    profilerThreadName("main");
+    if (perfCounters)
+        perfCounters = initPerfCounters();
+    profilerEnabled = !tracePath.empty() || perfCounters;
+    initGame();
+    const std::vector<PointLight> startLights = lights;
+
+    using clock = std::chrono::steady_clock;
+    std::vector<double> frameMs;
+    frameMs.reserve(log.ticks.size() * repeat);
+    FrameOutput frame;
+    for (int pass = 0; pass < repeat; ++pass)
+    {
+        // Every pass starts from the world initGame() built: the previous pass moved lights,
+        // opened doors and left rebakes of both in flight
+        if (pass > 0) {
+            shutdownLightmap();
+            lights = startLights;
+            initDoors();
+            initLightmap();
+        }
+        entities = EntityStore();
+        resetPlayer({log.startX, log.startY, log.startRotation});
+        viewModes = ViewModes();
+
+        if (simOnly) {
+            auto start = clock::now();
+            for (uint16_t buttons : log.ticks)
+                stepSimulation(buttons);
+            frameMs.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+            continue;
+        }
+
+        for (uint16_t buttons : log.ticks)
+        {
+            auto start = clock::now();
+            PROFILE_ZONE("frame");
+            stepSimulation(buttons);
+            updateLightmap();
+            setCamera(player);
+            buildFrame(frame);
+            frameMs.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+        }
+    }
+
+    // The final pose doubles as a determinism check between builds
+    std::printf("ticks %zu  final pose %.3f %.3f %.4f\n", log.ticks.size() * repeat, player.x, player.y, player.rotation);
+    if (simOnly) {
+        double totalMs = 0.0;
+        for (double ms : frameMs)
+            totalMs += ms;
+        std::printf("simulation only: %.0f ticks/s\n", log.ticks.size() * repeat / (totalMs / 1000.0));
+        shutdownLightmap();
+        shutdownWorkers();
+        return 0;
+    }
+
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double ms : frameMs)
+        total += ms;
+    std::printf("frame ms  mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+                total / frameMs.size(), percentile(sorted, 0.50), percentile(sorted, 0.95),
+                percentile(sorted, 0.99), sorted.back());
+
+    if (perfCounters) {
+        printPerfReport(static_cast<long long>(frameMs.size()));
+        shutdownPerfCounters();
+    }
+
+    shutdownLightmap();
+    shutdownWorkers();
+    if (!tracePath.empty() && !writeChromeTrace(tracePath))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+// Outputs the interpolated vertex colour
+in vec3 vertexColor;
+out vec4 FragColor;
+void main()
+{
+   FragColor = vec4(vertexColor, 1.0f);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// Minimap, ray lines, projection, player marker and overlay: position and colour per vertex.
+// playerPos moves the marker; viewScale and viewOffset place the minimap in its viewport.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+out vec3 vertexColor;
+uniform vec2 playerPos;
+uniform vec2 viewScale;
+uniform vec2 viewOffset;
+void main()
+{
+   vec3 worldPos = aPos + vec3(playerPos, 0.0);
+   gl_Position = vec4(worldPos.xy * viewScale + viewOffset, worldPos.z, 1.0);
+   vertexColor = aColor;
+}
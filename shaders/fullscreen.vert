@@ -0,0 +1,8 @@
+#version 330 core
+// Two triangles over the whole viewport, which is set to the area the pass fills. Used by the
+// GPU raycaster's passes and the indexed framebuffer's palette expansion; needs no vertex buffer.
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
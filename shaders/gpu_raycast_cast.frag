@@ -0,0 +1,146 @@
+#version 330 core
+// GPU raycaster cast pass, one fragment per pixel column: the same two walks as
+// generateRayLinesAndDistances(), vertical grid lines then horizontal ones, keeping the nearer hit.
+// Writes the corrected distance, texture column, light level and tile of the hit.
+out vec4 ColumnHit;
+
+uniform usampler2D cells;     // Per map cell: tile, tile light, door open * 255, door runs along Y
+uniform vec2 camera;
+uniform float cameraRotation;
+uniform float planeHalfWidth; // tan of half the field of view
+uniform int columns;
+uniform int mapSize;
+
+const float PI = 3.14159265358979;
+
+// Holds where a walk stopped and what it hit
+struct Hit {
+    vec2 position;
+    int tile;
+    int cell;     // -1 if the walk left the map
+    bool door;
+    bool alongY;
+    float open;
+};
+
+// Test the mid-cell plane of a door, moving position to the hit point on success
+bool hitDoor(uvec4 cell, int gridX, int gridY, inout vec2 position, float tanth, float atanth)
+{
+    float cellL = float(gridX) * SQ;
+    float cellB = float(mapSize - 1 - gridY) * SQ;
+    float open = float(cell.b) / 255.0;
+    vec2 hit;
+    float along;
+    if (cell.a != 0u) {
+        hit.x = cellL + SQ / 2.0;
+        hit.y = position.y + (hit.x - position.x) * tanth;
+        along = (hit.y - cellB) / SQ;
+    } else {
+        hit.y = cellB + SQ / 2.0;
+        hit.x = position.x + (hit.y - position.y) * atanth;
+        along = (hit.x - cellL) / SQ;
+    }
+    if (along < open || along > 1.0)
+        return false;
+    position = hit;
+    return true;
+}
+
+Hit walk(vec2 position, vec2 step, float tanth, float atanth)
+{
+    Hit hit = Hit(position, 1, -1, false, false, 0.0);
+    for (int i = 0; i <= 2 * mapSize; ++i)
+    {
+        int gridX = int(position.x / SQ);
+        int gridY = int(float(mapSize) - position.y / SQ);
+        if (gridX < 0 || gridX >= mapSize || gridY < 0 || gridY >= mapSize)
+            break;
+        uvec4 cell = texelFetch(cells, ivec2(gridX, gridY), 0);
+        int tile = int(cell.r);
+        if (tile == TILE_DOOR || tile == TILE_THIN) {
+            if (hitDoor(cell, gridX, gridY, position, tanth, atanth)) {
+                hit = Hit(position, tile, gridY * mapSize + gridX, true, cell.a != 0u, float(cell.b) / 255.0);
+                return hit;
+            }
+        } else if (tile != 0) {
+            hit = Hit(position, tile, gridY * mapSize + gridX, false, false, 0.0);
+            return hit;
+        }
+        position += step;
+    }
+    hit.position = position;
+    return hit;
+}
+
+void main()
+{
+    // The column's point on the camera plane, as in updateColumnTables()
+    int column = int(gl_FragCoord.x);
+    float plane = planeHalfWidth * (1.0 - (2.0 * float(column) + 1.0) / float(columns));
+    vec2 direction = vec2(cos(cameraRotation), sin(cameraRotation));
+    vec2 ray = direction + vec2(-direction.y, direction.x) * plane;
+    if (ray.x == 0.0) ray.x = 1e-7;
+    if (ray.y == 0.0) ray.y = 1e-7;
+    float rayAngle = cameraRotation + atan(plane);
+    float tanth = ray.y / ray.x;
+    float atanth = ray.x / ray.y;
+    float mapExtent = float(mapSize) * SQ;
+
+    // Vertical grid intersections
+    vec2 r;
+    float dx;
+    if (ray.x > 0.0) {
+        r.x = ceil(camera.x / SQ) * SQ + 0.0001;
+        dx = SQ;
+    } else {
+        r.x = floor(camera.x / SQ) * SQ - 0.0001;
+        dx = -SQ;
+    }
+    r.y = camera.y + (r.x - camera.x) * tanth;
+    if (r.y > mapExtent) { r.y = mapExtent; r.x = camera.x + (r.y - camera.y) * atanth; }
+    else if (r.y < 0.0) { r.y = 0.0; r.x = camera.x + (r.y - camera.y) * atanth; }
+    Hit v = walk(r, vec2(dx, dx * tanth), tanth, atanth);
+
+    // Horizontal grid intersections
+    float dy;
+    if (ray.y > 0.0) {
+        r.y = ceil(camera.y / SQ) * SQ + 0.0001;
+        dy = SQ;
+    } else {
+        r.y = floor(camera.y / SQ) * SQ - 0.0001;
+        dy = -SQ;
+    }
+    r.x = camera.x + (r.y - camera.y) * atanth;
+    if (r.x > mapExtent) { r.x = mapExtent; r.y = camera.y + (r.x - camera.x) * tanth; }
+    else if (r.x < 0.0) { r.x = 0.0; r.y = camera.y + (r.x - camera.x) * tanth; }
+    Hit h = walk(r, vec2(dy * atanth, dy), tanth, atanth);
+
+    // Nearer hit, measured along the camera direction so there is no fisheye, as on the CPU
+    float hDistance = dot(h.position - camera, direction);
+    float vDistance = dot(v.position - camera, direction);
+    bool useH = hDistance < vDistance;
+    Hit hit = useH ? h : v;
+    float distance = useH ? hDistance : vDistance;
+    bool hitEW = hit.door ? !hit.alongY : useH;
+
+    float along = hitEW ? hit.position.x : hit.position.y;
+    float wallX = along / SQ - floor(along / SQ);
+    if (hit.door)
+        wallX = max(wallX - hit.open, 0.0);
+
+    int tx = clamp(int(wallX * float(TEX_SIZE)), 0, TEX_SIZE - 1);
+    if (!hitEW) {
+        if (rayAngle < PI)
+            tx = TEX_SIZE - 1 - tx;
+    } else if (rayAngle > PI / 2.0 && rayAngle < 3.0 * PI / 2.0) {
+        tx = TEX_SIZE - 1 - tx;
+    }
+    int level = LIGHT_LEVELS - 1;
+    if (hit.cell >= 0)
+        level = int(texelFetch(cells, ivec2(hit.cell % mapSize, hit.cell / mapSize), 0).g);
+    level -= int(distance * FOG_SCALE);
+    if (hitEW) level -= SIDE_SHADE;
+    level = clamp(level, 0, LIGHT_LEVELS - 1);
+
+    ColumnHit = vec4(distance, float(tx), float(level), float(clamp(hit.tile, 0, TILE_TYPES - 1)));
+}
@@ -0,0 +1,30 @@
+#version 330 core
+// GPU raycaster shade pass, one fragment per pixel of the projection: the column's hit gives the
+// wall's span, and pixels inside it look their texel up through the colormap and palette
+out vec4 FragColor;
+
+uniform sampler2D columnHits; // Cast pass output, one texel per pixel column
+uniform usampler2D textures;  // Wall textures stacked by tile type, palette indices
+uniform usampler2D shading;   // Colormap: light level x palette index -> palette index
+uniform sampler2D palette;    // RGB per palette index
+uniform vec4 projectionRect;  // Left, bottom, width, height in framebuffer pixels
+uniform float planeHalfWidth; // tan of half the field of view; walls shrink as it widens
+
+void main()
+{
+    vec2 pixel = gl_FragCoord.xy - projectionRect.xy;
+    vec4 hit = texelFetch(columnHits, ivec2(int(pixel.x), 0), 0);
+
+    // Vertical span of the wall in projection pixels, scaled by the projection's width as on
+    // the CPU; nothing is drawn above or below it
+    float y = pixel.y;
+    float sliceHeight = 64.0 * projectionRect.z / (hit.x * planeHalfWidth) * 0.5;
+    float startY = projectionRect.w / 2.0 - sliceHeight / 2.0;
+    if (y < startY || y >= startY + sliceHeight)
+        discard;
+
+    int ty = clamp(int((y - startY) / sliceHeight * float(TEX_SIZE)), 0, TEX_SIZE - 1);
+    uint index = texelFetch(textures, ivec2(int(hit.y), int(hit.w) * TEX_SIZE + ty), 0).r;
+    uint shaded = texelFetch(shading, ivec2(int(index), int(hit.z)), 0).r;
+    FragColor = vec4(texelFetch(palette, ivec2(int(shaded), 0), 0).rgb, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+// Indexed framebuffer expansion, one fragment per pixel of the projection: the nearest stored
+// pixel's palette index looked up in the palette
+out vec4 FragColor;
+
+uniform usampler2D indices;  // Column-major framebuffer: x is the row, y the column
+uniform sampler2D palette;   // RGB per palette index
+uniform vec4 projectionRect; // Left, bottom, width, height in framebuffer pixels
+
+void main()
+{
+    vec2 position = (gl_FragCoord.xy - projectionRect.xy) / projectionRect.zw;
+    ivec2 size = textureSize(indices, 0);
+    int column = min(int(position.x * float(size.y)), size.y - 1);
+    int row = min(int(position.y * float(size.x)), size.x - 1);
+    uint index = texelFetch(indices, ivec2(row, column), 0).r;
+    FragColor = vec4(texelFetch(palette, ivec2(int(index), 0), 0).rgb, 1.0);
+}
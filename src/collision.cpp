@@ -0,0 +1,108 @@
+// Circle bodies against the grid, one body or a batch of them at a time
+#include "collision.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Holds a blocking cell a body overlaps
+struct CellContact {
+    float left, bottom; // World position of the cell's lower left corner
+    float distance2;    // Squared distance from the body's centre to the cell
+};
+
+// Squared distance from (x, y) to the cell at (left, bottom), and the vector from its nearest point
+static float cellDistance2(float x, float y, float left, float bottom, float& awayX, float& awayY)
+{
+    awayX = x - std::clamp(x, left, left + sq);
+    awayY = y - std::clamp(y, bottom, bottom + sq);
+    return awayX * awayX + awayY * awayY;
+}
+
+// Push the body at (x, y) out of every blocking cell it overlaps
+static void pushOutOfCells(float& x, float& y, float radius, const std::vector<Door>& doorTable)
+{
+    int left = int(std::floor((x - radius) / sq));
+    int right = int(std::floor((x + radius) / sq));
+    int bottom = int(std::floor((y - radius) / sq));
+    int top = int(std::floor((y + radius) / sq));
+
+    // Most of the time a body is well inside one open cell and there's nothing to look at
+    if (left == right && bottom == top && left >= 0 && left < mp && bottom >= 0 && bottom < mp &&
+        mapArray[(mp - 1 - bottom) * mp + left] == 0)
+        return;
+
+    CellContact contacts[4];
+    int count = 0;
+    float radius2 = radius * radius;
+    for (int row = bottom; row <= top; ++row)
+    {
+        for (int column = left; column <= right; ++column)
+        {
+            // Rows count up from the bottom here; map rows count down from the top. Empty floor
+            // is by far the most common cell, so it's told apart without the door lookup.
+            int grid_y = mp - 1 - row;
+            bool outside = column < 0 || column >= mp || grid_y < 0 || grid_y >= mp;
+            if (!outside) {
+                int cell = grid_y * mp + column;
+                if (mapArray[cell] == 0 || !blocksMovement(cell, doorTable))
+                    continue;
+            }
+            float awayX, awayY;
+            float distance2 = cellDistance2(x, y, float(column * sq), float(row * sq), awayX, awayY);
+            if (distance2 < radius2)
+                contacts[count++] = {float(column * sq), float(row * sq), distance2};
+        }
+    }
+    if (count == 0)
+        return;
+
+    // Nearest cell first: once the body is off the face it rests on, the corners of that face's
+    // neighbours no longer reach it, so it slides over the seams of a flat wall without snagging.
+    // There are at most four, so an insertion sort is all it takes.
+    for (int i = 1; i < count; ++i)
+    {
+        CellContact contact = contacts[i];
+        int j = i;
+        for (; j > 0 && contacts[j - 1].distance2 > contact.distance2; --j)
+            contacts[j] = contacts[j - 1];
+        contacts[j] = contact;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        float awayX, awayY;
+        float distance2 = cellDistance2(x, y, contacts[i].left, contacts[i].bottom, awayX, awayY);
+        // A centre inside a cell has no way out to prefer; leave it to walk out
+        if (distance2 >= radius2 || distance2 == 0.0f)
+            continue;
+        float push = radius / std::sqrt(distance2) - 1.0f;
+        x += awayX * push;
+        y += awayY * push;
+    }
+}
+
+void moveCircle(float& x, float& y, float dx, float dy, float radius, const std::vector<Door>& doorTable)
+{
+    radius = std::clamp(radius, minBodyRadius, maxBodyRadius);
+
+    // Steps of at most half the radius can't carry the centre into a cell it was clear of,
+    // so every push goes back the way the body came and nothing is tunnelled through
+    float maxStep = radius * 0.5f;
+    float length2 = dx * dx + dy * dy;
+    int steps = length2 <= maxStep * maxStep ? 1 : int(std::ceil(std::sqrt(length2) / maxStep));
+    float stepX = dx / steps, stepY = dy / steps;
+    for (int i = 0; i < steps; ++i)
+    {
+        x += stepX;
+        y += stepY;
+        pushOutOfCells(x, y, radius, doorTable);
+    }
+}
+
+void moveCircles(float* x, float* y, const float* dx, const float* dy, const float* radius, size_t count,
+                 const std::vector<Door>& doorTable)
+{
+    PROFILE_ZONE("move bodies");
+    for (size_t i = 0; i < count; ++i)
+        moveCircle(x[i], y[i], dx[i], dy[i], radius[i], doorTable);
+}
@@ -0,0 +1,22 @@
+// Circle bodies against the grid: each move is split into steps no longer than the body's radius,
+// and after each step the body is pushed out of the blocking cells it overlaps. Bodies slide along
+// walls and round corners instead of stopping dead, and can't pass through a wall at any speed.
+#pragma once
+
+#include "raycast.h"
+
+#include <cstddef>
+
+const float playerRadius = 12.0f; // Player's collision radius in world units
+const float minBodyRadius = 1.0f;              // Smaller radii are clamped, so steps stay a sensible length
+const float maxBodyRadius = sq * 0.5f - 1.0f; // Radii are clamped to this, so a body overlaps at most 2 x 2 cells
+
+// Move one body by (dx, dy), sliding along whatever blocks it. Doors block as in blocksMovement(),
+// and a body that doesn't move is still pushed out of a door that shuts against its edge.
+void moveCircle(float& x, float& y, float dx, float dy, float radius, const std::vector<Door>& doorTable = doors);
+
+// Move count bodies held as parallel arrays, each by its own (dx, dy). The cost is a few cells per
+// step per body and doesn't depend on the map size or on the other bodies; bodies don't collide
+// with each other.
+void moveCircles(float* x, float* y, const float* dx, const float* dy, const float* radius, size_t count,
+                 const std::vector<Door>& doorTable = doors);
@@ -0,0 +1,227 @@
+// Entities as parallel arrays and the spatial hash that files them by map cell
+#include "entities.h"
+#include "collision.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int minEntityBucketBits = 10;
+
+// Bucket a map cell's entities are listed in. Cells wrap around the table in map order, so the
+// cells a query visits sit next to each other, and a table as large as the map never shares one.
+static int bucketFor(const EntityStore& store, int cell)
+{
+    return cell & ((1 << store.bucketBits) - 1);
+}
+
+static void linkEntity(EntityStore& store, int index)
+{
+    int& head = store.bucketHead[bucketFor(store, store.cell[index])];
+    store.prev[index] = -1;
+    store.next[index] = head;
+    if (head >= 0)
+        store.prev[head] = index;
+    head = index;
+}
+
+static void unlinkEntity(EntityStore& store, int index)
+{
+    int before = store.prev[index], after = store.next[index];
+    if (before >= 0)
+        store.next[before] = after;
+    else
+        store.bucketHead[bucketFor(store, store.cell[index])] = after;
+    if (after >= 0)
+        store.prev[after] = before;
+}
+
+// Size the table to 1 << bits buckets and refile every entity
+static void rehashEntities(EntityStore& store, int bits)
+{
+    store.bucketBits = bits;
+    store.bucketHead.assign(size_t(1) << bits, -1);
+    for (size_t i = 0; i < store.size(); ++i)
+        linkEntity(store, int(i));
+}
+
+int entityCell(float x, float y)
+{
+    int column = std::clamp(int(std::floor(x / sq)), 0, mp - 1);
+    int row = std::clamp(int(std::floor(y / sq)), 0, mp - 1);
+    return (mp - 1 - row) * mp + column;
+}
+
+int spawnEntity(EntityStore& store, float x, float y, float heading, float vx, float vy, float radius, uint16_t sprite)
+{
+    int index = int(store.size());
+    store.x.push_back(x);
+    store.y.push_back(y);
+    store.heading.push_back(heading);
+    store.vx.push_back(vx);
+    store.vy.push_back(vy);
+    store.radius.push_back(std::clamp(radius, minBodyRadius, maxBodyRadius));
+    store.maxRadius = std::max(store.maxRadius, store.radius.back());
+    store.sprite.push_back(sprite);
+    store.cell.push_back(entityCell(x, y));
+    store.next.push_back(-1);
+    store.prev.push_back(-1);
+
+    // Keep at least two buckets per entity, so lists stay about one cell long
+    int bits = std::max(store.bucketBits, minEntityBucketBits);
+    while ((size_t(1) << bits) < store.size() * 2)
+        ++bits;
+    if (bits != store.bucketBits)
+        rehashEntities(store, bits);
+    else
+        linkEntity(store, index);
+    return index;
+}
+
+void removeEntity(EntityStore& store, int index)
+{
+    int last = int(store.size()) - 1;
+    unlinkEntity(store, index);
+    if (index != last) {
+        unlinkEntity(store, last);
+        store.x[index] = store.x[last];
+        store.y[index] = store.y[last];
+        store.heading[index] = store.heading[last];
+        store.vx[index] = store.vx[last];
+        store.vy[index] = store.vy[last];
+        store.radius[index] = store.radius[last];
+        store.sprite[index] = store.sprite[last];
+        store.cell[index] = store.cell[last];
+        linkEntity(store, index);
+    }
+    store.x.pop_back();
+    store.y.pop_back();
+    store.heading.pop_back();
+    store.vx.pop_back();
+    store.vy.pop_back();
+    store.radius.pop_back();
+    store.sprite.pop_back();
+    store.cell.pop_back();
+    store.next.pop_back();
+    store.prev.pop_back();
+}
+
+// Reorder every array bucket by bucket, which is map order, refile every entity and start
+// counting ticks again. A pass over the entities then walks the map, and so does the hash.
+static void sortEntities(EntityStore& store)
+{
+    PROFILE_ZONE("sort entities");
+    std::vector<int> order;
+    order.reserve(store.size());
+    for (int head : store.bucketHead)
+        for (int e = head; e >= 0; e = store.next[e])
+            order.push_back(e);
+
+    auto reorder = [&](auto& values) {
+        auto sorted = values;
+        for (size_t i = 0; i < order.size(); ++i)
+            sorted[i] = values[order[i]];
+        values.swap(sorted);
+    };
+    reorder(store.x);
+    reorder(store.y);
+    reorder(store.heading);
+    reorder(store.vx);
+    reorder(store.vy);
+    reorder(store.radius);
+    reorder(store.sprite);
+    for (size_t i = 0; i < store.size(); ++i)
+        store.cell[i] = entityCell(store.x[i], store.y[i]);
+    rehashEntities(store, store.bucketBits);
+    store.ticksSinceSort = 0;
+}
+
+void stepEntities(EntityStore& store, const std::vector<Door>& doorTable)
+{
+    if (store.size() == 0)
+        return;
+    moveCircles(store.x.data(), store.y.data(), store.vx.data(), store.vy.data(), store.radius.data(),
+                store.size(), doorTable);
+
+    if (++store.ticksSinceSort >= entitySortTicks) {
+        sortEntities(store);
+        return;
+    }
+
+    // Most entities stay in their cell from one tick to the next, so only the few that crossed
+    // into another one are moved between lists
+    PROFILE_ZONE("refile entities");
+    for (size_t i = 0; i < store.size(); ++i)
+    {
+        int cell = entityCell(store.x[i], store.y[i]);
+        if (cell == store.cell[i])
+            continue;
+        unlinkEntity(store, int(i));
+        store.cell[i] = cell;
+        linkEntity(store, int(i));
+    }
+}
+
+// Call visit(index) for every entity filed in a cell within the world box, each once
+template <typename Visit>
+static void visitEntityCells(const EntityStore& store, float left, float bottom, float right, float top, Visit visit)
+{
+    if (store.size() == 0)
+        return;
+    int column0 = std::max(int(std::floor(left / sq)), 0), column1 = std::min(int(std::floor(right / sq)), mp - 1);
+    int row0 = std::max(int(std::floor(bottom / sq)), 0), row1 = std::min(int(std::floor(top / sq)), mp - 1);
+    for (int row = row0; row <= row1; ++row)
+    {
+        for (int column = column0; column <= column1; ++column)
+        {
+            // Other cells can share the bucket; their entities are skipped here and listed
+            // when their own cell is visited
+            int cell = (mp - 1 - row) * mp + column;
+            for (int e = store.bucketHead[bucketFor(store, cell)]; e >= 0; e = store.next[e])
+                if (store.cell[e] == cell)
+                    visit(e);
+        }
+    }
+}
+
+void queryEntities(const EntityStore& store, float x, float y, float distance, std::vector<int>& found)
+{
+    found.clear();
+    // Entities are filed by their centre, so the box grows by the largest radius
+    float reach = distance + store.maxRadius;
+    visitEntityCells(store, x - reach, y - reach, x + reach, y + reach, [&](int e) {
+        float dx = store.x[e] - x, dy = store.y[e] - y;
+        float within = distance + store.radius[e];
+        if (dx * dx + dy * dy < within * within)
+            found.push_back(e);
+    });
+}
+
+void cullEntities(const EntityStore& store, const Pose& camera, float maxDistance, std::vector<int>& visible)
+{
+    visible.clear();
+    float dirX = std::cos(camera.rotation), dirY = std::sin(camera.rotation);
+    float leftX = -dirY, leftY = dirX;
+
+    // The view is the triangle from the camera to the two edges of the camera plane at maxDistance
+    float edge = maxDistance * viewPlaneHalfWidth;
+    float cornersX[3] = {camera.x, camera.x + dirX * maxDistance + leftX * edge, camera.x + dirX * maxDistance - leftX * edge};
+    float cornersY[3] = {camera.y, camera.y + dirY * maxDistance + leftY * edge, camera.y + dirY * maxDistance - leftY * edge};
+    float left = *std::min_element(cornersX, cornersX + 3) - store.maxRadius;
+    float right = *std::max_element(cornersX, cornersX + 3) + store.maxRadius;
+    float bottom = *std::min_element(cornersY, cornersY + 3) - store.maxRadius;
+    float top = *std::max_element(cornersY, cornersY + 3) + store.maxRadius;
+
+    // A circle is in view if it's in front of the camera, within range, and not wholly outside
+    // either edge of the view; edgeScale turns a distance across an edge into view coordinates
+    float edgeScale = std::sqrt(1.0f + viewPlaneHalfWidth * viewPlaneHalfWidth);
+    visitEntityCells(store, left, bottom, right, top, [&](int e) {
+        float dx = store.x[e] - camera.x, dy = store.y[e] - camera.y;
+        float forward = dx * dirX + dy * dirY;
+        float across = std::fabs(dx * leftX + dy * leftY);
+        float radius = store.radius[e];
+        if (forward > 0.0f && forward - radius < maxDistance &&
+            across - forward * viewPlaneHalfWidth < radius * edgeScale)
+            visible.push_back(e);
+    });
+}
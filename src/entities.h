@@ -0,0 +1,55 @@
+// Entities held as parallel arrays, filed in a spatial hash of sq-sized map cells so queries
+// only visit the cells around them. The hash is kept up to date as entities move: only an
+// entity that crosses into another cell is moved between lists. Now and then the arrays are
+// put back in cell order, so entities near each other in the map are near each other in memory.
+#pragma once
+
+#include "raycast.h"
+
+#include <cstdint>
+
+const int entitySortTicks = 60; // Ticks between reorders of the arrays by cell
+
+// Holds every entity, one index across all arrays. Indices change when an entity is removed
+// (the last one takes its place) and when stepEntities() reorders the arrays, so hold on to them
+// only within a tick. Cells are map cells, so empty the store before loading another map.
+struct EntityStore {
+    std::vector<float> x, y;       // World position
+    std::vector<float> heading;    // Radians, the direction the sprite faces. Only for drawing: nothing here
+                                   // reads it or keeps it in line with vx, vy, so set it when steering.
+    std::vector<float> vx, vy;     // Movement wanted per tick
+    std::vector<float> radius;     // Collision radius, as for moveCircles()
+    std::vector<uint16_t> sprite;  // Sprite id
+
+    // Spatial hash: each entity is linked into the list of the bucket its map cell hashes to
+    std::vector<int> cell;         // Map cell each entity is filed under
+    std::vector<int> next, prev;   // Neighbours in the bucket's list, -1 at either end
+    std::vector<int> bucketHead;   // First entity per bucket, -1 if empty
+    int bucketBits = 0;            // bucketHead holds 1 << bucketBits buckets
+    float maxRadius = 0.0f;        // Largest radius spawned, how far past its cell an entity reaches
+    int ticksSinceSort = 0;        // Ticks since the arrays were last put in cell order
+
+    size_t size() const { return x.size(); }
+};
+
+// Map cell an entity at (x, y) is filed under, clamped to the map
+int entityCell(float x, float y);
+
+// Add an entity and file it in the hash. Returns its index. radius is clamped to the limits in collision.h.
+int spawnEntity(EntityStore& store, float x, float y, float heading, float vx, float vy, float radius, uint16_t sprite);
+
+// Remove an entity; the last entity moves into its index
+void removeEntity(EntityStore& store, int index);
+
+// Move every entity by its velocity with moveCircles(), then refile those that changed cell.
+// Blocked entities slide along walls and keep their velocity and heading. Every entitySortTicks ticks the
+// arrays are reordered by cell, which renumbers the entities.
+void stepEntities(EntityStore& store, const std::vector<Door>& doorTable = doors);
+
+// Fill found with the entities whose circle reaches within distance of (x, y), in no particular
+// order. Only the cells within that distance are visited.
+void queryEntities(const EntityStore& store, float x, float y, float distance, std::vector<int>& found);
+
+// Fill visible with the entities inside the camera's field of view and closer than maxDistance,
+// in no particular order. Only the cells around the view triangle are visited.
+void cullEntities(const EntityStore& store, const Pose& camera, float maxDistance, std::vector<int>& visible);
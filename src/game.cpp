@@ -0,0 +1,149 @@
+// Fixed-timestep simulation driven by a button mask, and the CPU side of building a frame
+#include "game.h"
+#include "lightmap.h"
+#include "profiler.h"
+#include "sector.h"
+#include "voxel.h"
+
+#include <chrono>
+
+ViewModes viewModes;
+Pose player;
+Pose previousPlayer;
+EntityStore entities;
+
+// Buttons held on the previous tick, for detecting presses
+static unsigned previousButtons = 0;
+
+// Used for diagonal movement normalization
+const float sqrhf = sqrt(1.0f/2.0f);
+
+void initGame()
+{
+    resetPlayer({256.0f, 256.0f, float(M_PI/2 + 0.01)});
+    viewModes = ViewModes();
+    entities = EntityStore();
+
+    // Resolve door and thin wall tiles into the door side table
+    initDoors();
+
+    // Build the palette, colormap and wall textures used to shade the projection
+    initShading();
+
+    // Bake the point lights into the wall faces and start the background rebaker
+    initLightmap();
+
+    // Heightmap terrain for the outdoor view, generated once something asks for it
+    initTerrainLazy(1337);
+
+    // Build the sector/portal world used for angled walls
+    initSectorWorld();
+}
+
+void resetPlayer(const Pose& pose)
+{
+    player = pose;
+    previousPlayer = pose;
+    previousButtons = 0;
+    setCamera(pose);
+}
+
+void stepSimulation(unsigned buttons)
+{
+    PROFILE_ZONE("simulate");
+    unsigned pressed = buttons & ~previousButtons;
+    previousButtons = buttons;
+    previousPlayer = player;
+
+    float signfb = 0;
+    float signlr = 0;
+    if (buttons & buttonForward) signfb += 1.0f;
+    if (buttons & buttonLeft) signlr += 1.0f;
+    if (buttons & buttonBack) signfb -= 1.0f;
+    if (buttons & buttonRight) signlr -= 1.0f;
+    if (signfb != 0 && signlr != 0) {
+        signfb *= sqrhf;
+        signlr *= sqrhf;
+    }
+
+    // The sector world is drawn instead of the grid, so the player collides with its walls instead
+    if (viewModes.sectors)
+        movePlayerInSectors(player, signfb, signlr);
+    else
+        movePlayer(player, signfb, signlr);
+
+    stepEntities(entities);
+
+    if (buttons & buttonTurnLeft) turnPlayer(player, 1);
+    if (buttons & buttonTurnRight) turnPlayer(player, -1);
+
+    if (pressed & buttonUse) useDoorAhead(player);
+    updateDoors();
+
+    // Carry the first light to the player's position
+    if (pressed & buttonLight) moveLight(0, player.x, player.y);
+
+    if (pressed & buttonTerrain) viewModes.terrain = !viewModes.terrain;
+    if (pressed & buttonSectors) viewModes.sectors = !viewModes.sectors;
+}
+
+Pose interpolatedPlayer(float alpha)
+{
+    return interpolatePose(previousPlayer, player, alpha);
+}
+
+Pose interpolatePose(const Pose& from, const Pose& to, float alpha)
+{
+    // Turn the short way round when the rotation wrapped between the two poses
+    float turn = to.rotation - from.rotation;
+    if (turn > M_PI) turn -= 2 * M_PI;
+    else if (turn < -M_PI) turn += 2 * M_PI;
+
+    Pose pose;
+    pose.x = from.x + (to.x - from.x) * alpha;
+    pose.y = from.y + (to.y - from.y) * alpha;
+    pose.rotation = from.rotation + turn * alpha;
+    if (pose.rotation < 0) pose.rotation += 2 * M_PI;
+    else if (pose.rotation > 2 * M_PI) pose.rotation -= 2 * M_PI;
+    return pose;
+}
+
+void setCamera(const Pose& pose)
+{
+    playerX = pose.x;
+    playerY = pose.y;
+    rotation = pose.rotation;
+}
+
+void buildFrame(FrameOutput& frame)
+{
+    buildFrame(frame, viewModes, doors);
+}
+
+void buildFrame(FrameOutput& frame, const ViewModes& modes, const std::vector<Door>& doorTable,
+                ProjectionPath path)
+{
+    if (modes.terrain || (modes.sectors && path == projectionGpu))
+        path = projectionMesh;
+    frame.path = path;
+    frame.camera = {playerX, playerY, rotation};
+    frame.wallRows = wallRows;
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    {
+        PROFILE_ZONE("cast");
+        frame.rays = modes.sectors ? castSectors() : generateRayLinesAndDistances(doorTable);
+    }
+    auto cast = clock::now();
+    frame.projection.vertices.clear();
+    frame.projection.indices.clear();
+    if (path == projectionMesh) {
+        PROFILE_ZONE("build projection");
+        frame.projection = modes.terrain ? generateTerrainProjection() : generateProjectionInfo(frame.rays.hitInfo);
+    } else if (path == projectionIndexed) {
+        PROFILE_ZONE("render indexed projection");
+        renderIndexedProjection(frame.rays.hitInfo, frame.indexed);
+    }
+    frame.castMs = std::chrono::duration<float, std::milli>(cast - start).count();
+    frame.projectionMs = std::chrono::duration<float, std::milli>(clock::now() - cast).count();
+}
@@ -0,0 +1,89 @@
+// Fixed-timestep simulation driven by a button mask, and the CPU side of building a frame.
+// Shared by the window loop and the headless tools so both run exactly the same steps.
+#pragma once
+
+#include "entities.h"
+#include "raycast.h"
+
+// Buttons sampled each frame, combined into a mask
+const unsigned buttonForward   = 1u << 0; // W
+const unsigned buttonBack      = 1u << 1; // S
+const unsigned buttonLeft      = 1u << 2; // A
+const unsigned buttonRight     = 1u << 3; // D
+const unsigned buttonTurnLeft  = 1u << 4; // Left arrow
+const unsigned buttonTurnRight = 1u << 5; // Right arrow
+const unsigned buttonUse       = 1u << 6; // E: open/close door
+const unsigned buttonLight     = 1u << 7; // L: move the first light to the player
+const unsigned buttonTerrain   = 1u << 8; // T: toggle the terrain view
+const unsigned buttonSectors   = 1u << 9; // P: toggle the sector world
+
+// Holds the view toggles the buttons drive
+struct ViewModes {
+    bool terrain = false; // Project the heightmap terrain instead of grid walls
+    bool sectors = false; // Cast through the sector world instead of the grid
+};
+
+extern ViewModes viewModes;
+
+// The simulation advances in fixed ticks regardless of the frame rate, so movement, door
+// and turn speeds are per tick and a recording replays identically at any frame rate
+const int simTickRate = 60;
+const double simTickSeconds = 1.0 / simTickRate;
+
+// Ticks run in one frame at most. A frame that falls further behind drops the backlog
+// instead of spiralling into ever longer catch-up frames.
+const int maxTicksPerFrame = 8;
+
+// Player pose after the latest tick, and before it
+extern Pose player;
+extern Pose previousPlayer;
+
+// Every other moving thing, stepped each tick after the player. Empty until something spawns into it.
+extern EntityStore entities;
+
+// How a frame's projection reaches the screen
+enum ProjectionPath {
+    projectionMesh,    // Coloured rectangles per column and wall row
+    projectionIndexed, // 8-bit palette indices per pixel, expanded through the palette on the GPU
+    projectionGpu      // Cast and drawn by the GPU raycaster; the CPU still casts for the minimap rays but builds no projection
+};
+
+// Holds everything the CPU produces for one frame
+struct FrameOutput {
+    Pose camera;                // Camera the frame was cast from
+    RayLinesResult rays;        // Ray lines for the minimap and per-column hits
+    ProjectionPath path = projectionMesh;
+    VerticesIndices projection; // Projection rectangles for the right side of the window, on the mesh path
+    IndexedFramebuffer indexed; // Projection pixels, on the indexed path
+    float castMs = 0.0f;        // Time spent casting
+    float projectionMs = 0.0f;  // Time spent building the projection mesh
+    int wallRows = 0;           // Rows per column the projection was built with
+};
+
+// Build every table the simulation and cast need, and reset the player to the start
+void initGame();
+
+// Put the player at pose, with nothing to interpolate from, and clear button history
+void resetPlayer(const Pose& pose);
+
+// Advance the simulation one tick with the buttons currently held.
+// Toggles and door use act on the press, not while a button is held.
+void stepSimulation(unsigned buttons);
+
+// Player pose alpha of the way from the previous tick to the latest one (0..1)
+Pose interpolatedPlayer(float alpha);
+
+// Pose alpha of the way from one pose to another, turning the short way round
+Pose interpolatePose(const Pose& from, const Pose& to, float alpha);
+
+// Point the camera the cast renders from at pose
+void setCamera(const Pose& pose);
+
+// Cast and build the projection from the camera, with the current view modes and doors
+void buildFrame(FrameOutput& frame);
+
+// The same with the view modes and doors given, so a cast thread can build from a snapshot.
+// The projection is built for path where the view supports it: terrain is always a mesh, and
+// only the grid can be left to the GPU raycaster. frame.path says which was used.
+void buildFrame(FrameOutput& frame, const ViewModes& modes, const std::vector<Door>& doorTable,
+                ProjectionPath path = projectionMesh);
@@ -0,0 +1,187 @@
+// GPU raycaster: one grid walk per pixel column into a hit texture, then texturing per pixel
+#include "gpu_raycast.h"
+#include "shader.h"
+
+#include <cstdio>
+#include <string>
+
+// Uniforms of the cast pass, in the order given to loadShaderProgram()
+enum CastUniform { castCamera, castRotation, castPlaneHalfWidth, castColumns };
+// Uniforms of the shade pass
+enum ShadeUniform { shadeProjectionRect, shadePlaneHalfWidth };
+
+static ShaderProgram castShader, shadeShader;
+static GLuint gpuRaycastVAO = 0;
+static GLuint cellTexture = 0, wallTexture = 0, colormapTexture = 0, paletteTexture = 0;
+static GLuint columnHitTexture = 0, columnHitFramebuffer = 0;
+static int columnHitWidth = 0; // Pixel columns columnHitTexture has room for
+static std::vector<unsigned char> uploadedOpen; // Open amount last uploaded per door, 0..255
+
+// Constants from raycast.h, defined ahead of both passes' sources
+static std::string gpuRaycastDefines()
+{
+    char defines[512];
+    std::snprintf(defines, sizeof(defines),
+                  "#define SQ %d.0\n#define TEX_SIZE %d\n#define LIGHT_LEVELS %d\n#define TILE_TYPES %d\n"
+                  "#define FOG_SCALE %.9f\n#define SIDE_SHADE %d\n"
+                  "#define TILE_DOOR %d\n#define TILE_THIN %d\n",
+                  sq, texSize, lightLevels, numTileTypes, fogScale, sideShade, tileDoor, tileThin);
+    return defines;
+}
+
+// Texture units and the map size, set again whenever a pass is relinked
+static void bindCastUniforms(const ShaderProgram& program)
+{
+    glUniform1i(glGetUniformLocation(program.id, "cells"), 0);
+    glUniform1i(glGetUniformLocation(program.id, "mapSize"), mp);
+}
+
+static void bindShadeUniforms(const ShaderProgram& program)
+{
+    glUniform1i(glGetUniformLocation(program.id, "textures"), 1);
+    glUniform1i(glGetUniformLocation(program.id, "shading"), 2);
+    glUniform1i(glGetUniformLocation(program.id, "palette"), 3);
+    glUniform1i(glGetUniformLocation(program.id, "columnHits"), 4);
+}
+
+static GLuint createTexture(GLenum internalFormat, GLenum format, GLenum type, int width, int height, const void* data)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // Integer textures can't be filtered, and texelFetch() ignores filtering anyway
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
+    return texture;
+}
+
+static unsigned char doorOpenByte(const Door& door)
+{
+    return static_cast<unsigned char>(door.open * 255.0f + 0.5f);
+}
+
+bool initGpuRaycaster()
+{
+    std::string defines = gpuRaycastDefines();
+    if (!loadShaderProgram(castShader, "fullscreen.vert", "gpu_raycast_cast.frag",
+                           {"camera", "cameraRotation", "planeHalfWidth", "columns"}, defines, bindCastUniforms) ||
+        !loadShaderProgram(shadeShader, "fullscreen.vert", "gpu_raycast_shade.frag",
+                           {"projectionRect", "planeHalfWidth"}, defines, bindShadeUniforms)) {
+        deleteShaderProgram(castShader);
+        deleteShaderProgram(shadeShader);
+        return false;
+    }
+
+    // Map cells: tile, tile light, door open amount and door direction, uploaded once
+    std::vector<unsigned char> cells(size_t(mp) * mp * 4, 0);
+    for (int cell = 0; cell < mp * mp; ++cell)
+    {
+        cells[cell * 4 + 0] = static_cast<unsigned char>(mapArray[cell]);
+        cells[cell * 4 + 1] = tileLight[cell];
+    }
+    uploadedOpen.clear();
+    for (const Door& door : doors)
+    {
+        uploadedOpen.push_back(doorOpenByte(door));
+        cells[door.cell * 4 + 2] = uploadedOpen.back();
+        cells[door.cell * 4 + 3] = door.alongY ? 1 : 0;
+    }
+    cellTexture = createTexture(GL_RGBA8UI, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, mp, mp, cells.data());
+    wallTexture = createTexture(GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, texSize, texSize * numTileTypes, wallTextures);
+    colormapTexture = createTexture(GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, paletteRamps * rampShades, lightLevels, colormap);
+    paletteTexture = createTexture(GL_RGB32F, GL_RGB, GL_FLOAT, paletteRamps * rampShades, 1, palette);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &columnHitFramebuffer);
+
+    // Core profile draws need a vertex array bound, even with no attributes
+    glGenVertexArrays(1, &gpuRaycastVAO);
+    return true;
+}
+
+void updateGpuRaycasterDoors(const std::vector<Door>& doorTable)
+{
+    if (!castShader.id || doorTable.size() != uploadedOpen.size())
+        return;
+    glBindTexture(GL_TEXTURE_2D, cellTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < doorTable.size(); ++i)
+    {
+        const Door& door = doorTable[i];
+        unsigned char open = doorOpenByte(door);
+        if (open == uploadedOpen[i])
+            continue;
+        uploadedOpen[i] = open;
+        unsigned char cell[4] = {static_cast<unsigned char>(mapArray[door.cell]), tileLight[door.cell],
+                                 open, static_cast<unsigned char>(door.alongY ? 1 : 0)};
+        glTexSubImage2D(GL_TEXTURE_2D, 0, door.cell % mp, door.cell / mp, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, cell);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Make columnHitTexture at least columns wide, as the cast pass's render target
+static void reserveColumnHits(int columns)
+{
+    if (columns <= columnHitWidth)
+        return;
+    glDeleteTextures(1, &columnHitTexture);
+    columnHitTexture = createTexture(GL_RGBA32F, GL_RGBA, GL_FLOAT, columns, 1, nullptr);
+    columnHitWidth = columns;
+    glBindFramebuffer(GL_FRAMEBUFFER, columnHitFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, columnHitTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void drawGpuRaycast(const Pose& camera, const ViewLayout& layout)
+{
+    if (!castShader.id)
+        return;
+
+    // One ray per framebuffer pixel column, across the same camera plane as the CPU path's columns
+    int left = layout.projectionLeft;
+    int columns = layout.projectionWidth;
+    reserveColumnHits(columns);
+    glBindVertexArray(gpuRaycastVAO);
+
+    // Cast: one fragment per column into a one texel high row
+    glBindFramebuffer(GL_FRAMEBUFFER, columnHitFramebuffer);
+    glViewport(0, 0, columns, 1);
+    glUseProgram(castShader.id);
+    glUniform2f(castShader.uniforms[castCamera], camera.x, camera.y);
+    glUniform1f(castShader.uniforms[castRotation], camera.rotation);
+    glUniform1f(castShader.uniforms[castPlaneHalfWidth], viewPlaneHalfWidth);
+    glUniform1i(castShader.uniforms[castColumns], columns);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, cellTexture);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // Shade: every pixel of the projection reads its column's hit
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(left, 0, columns, layout.projectionHeight);
+    glUseProgram(shadeShader.id);
+    glUniform4f(shadeShader.uniforms[shadeProjectionRect], float(left), 0.0f, float(columns), float(layout.projectionHeight));
+    glUniform1f(shadeShader.uniforms[shadePlaneHalfWidth], viewPlaneHalfWidth);
+    const GLuint textures[5] = {cellTexture, wallTexture, colormapTexture, paletteTexture, columnHitTexture};
+    for (int unit = 1; unit < 5; ++unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, textures[unit]);
+    }
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glViewport(0, 0, layout.width, layout.height);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void shutdownGpuRaycaster()
+{
+    GLuint textures[5] = {cellTexture, wallTexture, colormapTexture, paletteTexture, columnHitTexture};
+    glDeleteTextures(5, textures);
+    glDeleteFramebuffers(1, &columnHitFramebuffer);
+    glDeleteVertexArrays(1, &gpuRaycastVAO);
+    deleteShaderProgram(castShader);
+    deleteShaderProgram(shadeShader);
+    columnHitWidth = 0;
+}
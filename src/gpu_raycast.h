@@ -0,0 +1,21 @@
+// Per-pixel raycaster on the GPU: the map lives in an integer texture and a fragment shader
+// walks the grid for every pixel column of the projection, texturing and shading per pixel.
+// Needs OpenGL 3.3 core; runs on software renderers such as Mesa llvmpipe.
+#pragma once
+
+#include "layout.h"
+#include "raycast.h"
+
+// Load both passes from shaders/gpu_raycast*, and upload the map, door state, wall textures, colormap and palette.
+// Needs a current GL context. Returns false, after printing why, if the shaders don't build.
+bool initGpuRaycaster();
+
+// Upload the door cells whose open amount changed since the last call
+void updateGpuRaycasterDoors(const std::vector<Door>& doorTable);
+
+// Draw the projection as seen from camera into the layout's projection area, one ray per pixel column.
+// Walls are lit by tile light, fog and face side; baked point lights are CPU path only.
+void drawGpuRaycast(const Pose& camera, const ViewLayout& layout);
+
+// Delete the program, textures and vertex array
+void shutdownGpuRaycaster();
@@ -0,0 +1,87 @@
+// GPU time per render pass from GL_TIME_ELAPSED queries, read back through a multi-frame ring
+#include "gpu_timer.h"
+
+#include <glad/glad.h>
+
+// Holds one frame's queries: one per pass, and which passes actually ran
+struct GpuFrameQueries {
+    GLuint queries[gpuPassCount];
+    bool issued[gpuPassCount];
+    bool pending; // Queries were issued and the results haven't been read yet
+};
+
+static GpuFrameQueries gpuFrames[gpuTimerFrames];
+static int gpuFrame = 0;              // Frame in the ring being recorded
+static GLuint activeQuery = 0;
+
+void initGpuTimers()
+{
+    for (GpuFrameQueries& frame : gpuFrames)
+    {
+        glGenQueries(gpuPassCount, frame.queries);
+        for (bool& issued : frame.issued)
+            issued = false;
+        frame.pending = false;
+    }
+    gpuFrame = 0;
+}
+
+void beginGpuPass(GpuPass pass)
+{
+    GpuFrameQueries& frame = gpuFrames[gpuFrame];
+    activeQuery = frame.queries[pass];
+    frame.issued[pass] = true;
+    glBeginQuery(GL_TIME_ELAPSED, activeQuery);
+}
+
+void endGpuPass()
+{
+    if (activeQuery == 0)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    activeQuery = 0;
+}
+
+bool finishGpuFrame(float* passMs)
+{
+    gpuFrames[gpuFrame].pending = true;
+    gpuFrame = (gpuFrame + 1) % gpuTimerFrames;
+
+    // The slot about to be reused is the oldest frame in flight. If the GPU still hasn't
+    // finished it, its result is dropped rather than waited for; the queries are simply reissued.
+    GpuFrameQueries& oldest = gpuFrames[gpuFrame];
+    bool read = false;
+    if (oldest.pending) {
+        bool available = true;
+        for (int pass = 0; pass < gpuPassCount && available; ++pass)
+        {
+            if (!oldest.issued[pass])
+                continue;
+            GLint ready = 0;
+            glGetQueryObjectiv(oldest.queries[pass], GL_QUERY_RESULT_AVAILABLE, &ready);
+            available = ready != 0;
+        }
+
+        if (available) {
+            for (int pass = 0; pass < gpuPassCount; ++pass)
+            {
+                GLuint64 elapsed = 0;
+                if (oldest.issued[pass])
+                    glGetQueryObjectui64v(oldest.queries[pass], GL_QUERY_RESULT, &elapsed);
+                passMs[pass] = elapsed / 1.0e6f;
+            }
+            read = true;
+        }
+    }
+
+    oldest.pending = false;
+    for (bool& issued : oldest.issued)
+        issued = false;
+    return read;
+}
+
+void shutdownGpuTimers()
+{
+    for (GpuFrameQueries& frame : gpuFrames)
+        glDeleteQueries(gpuPassCount, frame.queries);
+}
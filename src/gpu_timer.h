@@ -0,0 +1,31 @@
+// GPU time per render pass from GL_TIME_ELAPSED queries, read back through a multi-frame ring
+#pragma once
+
+// Render passes timed on the GPU
+enum GpuPass {
+    gpuPassMap,        // Clear and minimap
+    gpuPassRays,       // Minimap ray lines
+    gpuPassProjection, // Projection columns
+    gpuPassPlayer,     // Player marker
+    gpuPassHud,        // Performance overlay
+    gpuPassCount
+};
+
+const char* const gpuPassNames[gpuPassCount] = {"MAP", "RAYS", "PROJ", "PLYR", "HUD"};
+
+// Frames of queries in flight. Results are read this many frames late, so reading never stalls.
+const int gpuTimerFrames = 4;
+
+// Create the query objects. Needs a current GL context.
+void initGpuTimers();
+
+// Time GL commands between begin and end as one pass. Passes can't nest.
+void beginGpuPass(GpuPass pass);
+void endGpuPass();
+
+// Close the current frame's queries and read back the oldest frame if it has finished.
+// Returns true and fills passMs (gpuPassCount values, passes not run are 0) when a result was read.
+bool finishGpuFrame(float* passMs);
+
+// Delete the query objects
+void shutdownGpuTimers();
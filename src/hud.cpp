@@ -0,0 +1,259 @@
+// Performance overlay: a rolling frame-time graph and per-stage timings, built as a single mesh
+#include "hud.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+// Ring of recent frames, oldest overwritten first
+static HudFrameStats history[hudHistory];
+static int historyNext = 0;
+static int historyCount = 0;
+
+// Sums over the whole run for printHudReport()
+static HudFrameStats runTotals;
+static long long runFrames = 0;
+static long long runGpuFrames = 0;
+
+// Frames averaged for the text, so numbers are readable instead of flickering
+const int hudAverageFrames = 30;
+
+// Overlay layout in window pixels, anchored to the top left corner
+const int hudLeft = 4;
+const int hudTop = windowHeight - 4;
+const int hudPadding = 4;
+const int hudPixel = 2;                  // Size of one font pixel
+const int hudLineHeight = 7 * hudPixel;  // 5 rows of glyph plus 2 of spacing
+const int hudCharWidth = 4 * hudPixel;   // 3 columns of glyph plus 1 of spacing
+const int hudTextLines = 7;
+const int hudTextColumns = 50;
+const int hudBarWidth = 2;
+const int hudGraphHeight = 48;
+const int hudWidth = std::max(hudHistory * hudBarWidth, hudTextColumns * hudCharWidth) + 2 * hudPadding;
+const int hudHeight = hudTextLines * hudLineHeight + hudGraphHeight + 3 * hudPadding;
+
+// 3x5 glyphs, rows top to bottom, '#' lit
+struct HudGlyph {
+    char c;
+    const char* rows;
+};
+
+static const HudGlyph hudFont[] = {
+    {'0', "####.##.##.####"}, {'1', ".#.##..#..#.###"}, {'2', "###..#####..###"}, {'3', "###..####..####"},
+    {'4', "#.##.####..#..#"}, {'5', "####..###..####"}, {'6', "####..####.####"}, {'7', "###..#..#..#..#"},
+    {'8', "####.#####.####"}, {'9', "####.####..####"}, {'A', ".#.#.#####.##.#"}, {'B', "##.#.###.#.###."},
+    {'C', "####..#..#..###"}, {'D', "##.#.##.##.###."}, {'E', "####..##.#..###"}, {'F', "####..##.#..#.."},
+    {'G', "####..#.##.####"}, {'H', "#.##.####.##.##"}, {'I', "###.#..#..#.###"}, {'J', "..#..#..##.####"},
+    {'K', "#.##.###.#.##.#"}, {'L', "#..#..#..#..###"}, {'M', "#.#######.##.##"}, {'N', "##.#.##.##.##.#"},
+    {'O', ".#.#.##.##.#.#."}, {'P', "####.####..#..."}, {'Q', "####.##.####..#"}, {'R', "##.#.###.#.##.#"},
+    {'S', "####..###..####"}, {'T', "###.#..#..#..#."}, {'U', "#.##.##.##.####"}, {'V', "#.##.##.##.#.#."},
+    {'W', "#.##.#######.##"}, {'X', "#.##.#.#.#.##.#"}, {'Y', "#.##.#.#..#..#."}, {'Z', "###..#.#.#..###"},
+    {'.', "............#.."}, {'/', "..#..#.#.#..#.."}, {':', "....#.....#...."}, {'-', "......###......"},
+    {'%', "#.#..#.#.#..#.#"}
+};
+
+static const char* findGlyph(char c)
+{
+    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    for (const HudGlyph& glyph : hudFont)
+    {
+        if (glyph.c == c)
+            return glyph.rows;
+    }
+    return nullptr; // Spaces and unknown characters are blank
+}
+
+static void appendPixelRect(VerticesIndices& mesh, int left, int right, int bottom, int top, const float* rgb)
+{
+    appendRect(mesh, pixelToScreenX(left), pixelToScreenX(right), pixelToScreenY(bottom), pixelToScreenY(top), rgb);
+}
+
+// Append a line of text whose top left corner is at (x, y). Lit runs in a glyph row share one quad.
+static void appendText(VerticesIndices& mesh, int x, int y, const char* text, const float* rgb)
+{
+    for (; *text; ++text, x += hudCharWidth)
+    {
+        const char* rows = findGlyph(*text);
+        if (!rows)
+            continue;
+        for (int row = 0; row < 5; ++row)
+        {
+            int top = y - row * hudPixel;
+            for (int column = 0; column < 3; ++column)
+            {
+                if (rows[row * 3 + column] != '#')
+                    continue;
+                int run = column;
+                while (run + 1 < 3 && rows[row * 3 + run + 1] == '#')
+                    ++run;
+                appendPixelRect(mesh, x + column * hudPixel, x + (run + 1) * hudPixel, top - hudPixel, top, rgb);
+                column = run;
+            }
+        }
+    }
+}
+
+void recordHudFrame(const HudFrameStats& stats)
+{
+    history[historyNext] = stats;
+    historyNext = (historyNext + 1) % hudHistory;
+    historyCount = std::min(historyCount + 1, hudHistory);
+
+    runTotals.frameMs += stats.frameMs;
+    runTotals.simMs += stats.simMs;
+    runTotals.castMs += stats.castMs;
+    runTotals.projectionMs += stats.projectionMs;
+    runTotals.uploadMs += stats.uploadMs;
+    runTotals.drawMs += stats.drawMs;
+    runTotals.swapMs += stats.swapMs;
+    ++runFrames;
+    if (stats.gpuMs >= 0.0f) {
+        runTotals.gpuMs = std::max(runTotals.gpuMs, 0.0f) + stats.gpuMs;
+        for (int pass = 0; pass < gpuPassCount; ++pass)
+            runTotals.gpuPassMs[pass] += stats.gpuPassMs[pass];
+        ++runGpuFrames;
+    }
+}
+
+const char* frameBottleneck(float frameMs, float cpuWaitMs, float gpuMs)
+{
+    // Whichever side is busy for most of the frame is the one holding it back. The CPU's
+    // share excludes time blocked in swap and uploads, which is time spent waiting on the GPU.
+    const float busyShare = 0.8f;
+    if (gpuMs >= busyShare * frameMs)
+        return "GPU-BOUND";
+    if (frameMs - cpuWaitMs >= busyShare * frameMs)
+        return "CPU-BOUND";
+    return "SYNC-BOUND";
+}
+
+void printHudReport()
+{
+    if (runFrames == 0)
+        return;
+
+    float n = static_cast<float>(runFrames);
+    float frameMs = runTotals.frameMs / n;
+    float waitMs = (runTotals.swapMs + runTotals.uploadMs) / n;
+    float gpuMs = runGpuFrames > 0 ? runTotals.gpuMs / runGpuFrames : -1.0f;
+    std::printf("Frames: %lld, %.3f ms average (%.1f FPS)\n", runFrames, frameMs, 1000.0f / std::max(frameMs, 0.001f));
+    std::printf("CPU: %.3f ms working, %.3f ms waiting in swap (%.3f) and uploads (%.3f)\n",
+                frameMs - waitMs, waitMs, runTotals.swapMs / n, runTotals.uploadMs / n);
+    if (gpuMs >= 0.0f) {
+        std::printf("GPU: %.3f ms busy (", gpuMs);
+        for (int pass = 0; pass < gpuPassCount; ++pass)
+            std::printf("%s%s %.3f", pass > 0 ? ", " : "", gpuPassNames[pass], runTotals.gpuPassMs[pass] / runGpuFrames);
+        std::printf(")\n");
+    } else {
+        std::printf("GPU: no timer query results\n");
+    }
+    std::printf("Verdict: %s\n", frameBottleneck(frameMs, waitMs, gpuMs));
+}
+
+void generateHudMesh(VerticesIndices& mesh)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    const float panelColor[3] = {0.08f, 0.08f, 0.1f};
+    const float textColor[3] = {0.9f, 0.9f, 0.9f};
+    const float budgetColor[3] = {0.35f, 0.35f, 0.4f};
+    const float goodColor[3] = {0.2f, 0.8f, 0.3f};
+    const float slowColor[3] = {0.9f, 0.75f, 0.2f};
+    const float stutterColor[3] = {0.95f, 0.25f, 0.2f};
+
+    appendPixelRect(mesh, hudLeft, hudLeft + hudWidth, hudTop - hudHeight, hudTop, panelColor);
+
+    // Frame-time graph, newest frame on the right. Bars turn yellow past 60 FPS and red past 30 FPS.
+    int graphLeft = hudLeft + hudPadding;
+    int graphBottom = hudTop - hudHeight + hudPadding;
+    int budgetY = graphBottom + int(hudGraphHeight * (1000.0f / 60.0f) / hudGraphMaxMs);
+    appendPixelRect(mesh, graphLeft, graphLeft + hudHistory * hudBarWidth, budgetY, budgetY + 1, budgetColor);
+    for (int i = 0; i < historyCount; ++i)
+    {
+        const HudFrameStats& stats = history[(historyNext - historyCount + i + hudHistory) % hudHistory];
+        float ms = std::min(stats.frameMs, hudGraphMaxMs);
+        int height = std::max(1, int(hudGraphHeight * ms / hudGraphMaxMs));
+        const float* color = stats.frameMs > 1000.0f / 30.0f ? stutterColor
+                           : stats.frameMs > 1000.0f / 60.0f ? slowColor : goodColor;
+        int x = graphLeft + (hudHistory - historyCount + i) * hudBarWidth;
+        appendPixelRect(mesh, x, x + hudBarWidth, graphBottom, graphBottom + height, color);
+    }
+
+    // Averages over the most recent frames
+    HudFrameStats average;
+    average.gpuMs = 0.0f;
+    int frames = std::min(historyCount, hudAverageFrames);
+    int gpuFrames = 0;
+    float worstMs = 0.0f;
+    long long rays = 0;
+    for (int i = 0; i < frames; ++i)
+    {
+        const HudFrameStats& stats = history[(historyNext - 1 - i + hudHistory) % hudHistory];
+        average.frameMs += stats.frameMs;
+        average.simMs += stats.simMs;
+        average.castMs += stats.castMs;
+        average.projectionMs += stats.projectionMs;
+        average.uploadMs += stats.uploadMs;
+        average.drawMs += stats.drawMs;
+        average.swapMs += stats.swapMs;
+        average.castSteps += stats.castSteps;
+        average.uploadBytes += stats.uploadBytes;
+        rays += stats.rays;
+        worstMs = std::max(worstMs, stats.frameMs);
+        if (stats.gpuMs >= 0.0f) {
+            average.gpuMs += stats.gpuMs;
+            for (int pass = 0; pass < gpuPassCount; ++pass)
+                average.gpuPassMs[pass] += stats.gpuPassMs[pass];
+            ++gpuFrames;
+        }
+    }
+    if (frames == 0)
+        return;
+
+    float n = static_cast<float>(frames);
+    float frameMs = std::max(average.frameMs / n, 0.001f);
+    char line[64];
+    int y = hudTop - hudPadding;
+
+    std::snprintf(line, sizeof(line), "FPS %.0f  %.2f MS  MAX %.1f", 1000.0f / frameMs, frameMs, worstMs);
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+    y -= hudLineHeight;
+
+    std::snprintf(line, sizeof(line), "SIM %.2f CAST %.2f PROJ %.2f", average.simMs / n, average.castMs / n, average.projectionMs / n);
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+    y -= hudLineHeight;
+
+    std::snprintf(line, sizeof(line), "UPL %.2f DRAW %.2f SWAP %.2f", average.uploadMs / n, average.drawMs / n, average.swapMs / n);
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+    y -= hudLineHeight;
+
+    float gpuMs = gpuFrames > 0 ? average.gpuMs / gpuFrames : -1.0f;
+    float waitMs = (average.swapMs + average.uploadMs) / n;
+    if (gpuFrames > 0)
+        std::snprintf(line, sizeof(line), "GPU %.2f MS  WAIT %.2f  %s", gpuMs, waitMs, frameBottleneck(frameMs, waitMs, gpuMs));
+    else
+        std::snprintf(line, sizeof(line), "GPU -  WAIT %.2f  %s", waitMs, frameBottleneck(frameMs, waitMs, gpuMs));
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+    y -= hudLineHeight;
+
+    // Per-pass GPU time
+    int x = hudLeft + hudPadding;
+    for (int pass = 0; pass < gpuPassCount; ++pass)
+    {
+        std::snprintf(line, sizeof(line), "%s %.2f", gpuPassNames[pass], gpuFrames > 0 ? average.gpuPassMs[pass] / gpuFrames : 0.0f);
+        appendText(mesh, x, y, line, textColor);
+        x += 10 * hudCharWidth;
+    }
+    y -= hudLineHeight;
+
+    float raysPerSecond = rays / n * 1000.0f / frameMs;
+    float stepsPerRay = rays > 0 ? static_cast<float>(average.castSteps) / rays : 0.0f;
+    std::snprintf(line, sizeof(line), "RAYS/S %.2fM  STEPS/RAY %.1f", raysPerSecond / 1e6f, stepsPerRay);
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+    y -= hudLineHeight;
+
+    const HudFrameStats& latest = history[(historyNext - 1 + hudHistory) % hudHistory];
+    std::snprintf(line, sizeof(line), "UPLOAD %.1f KB/FRAME  RES %dX%d", average.uploadBytes / n / 1024.0f, latest.rays, latest.wallRows);
+    appendText(mesh, hudLeft + hudPadding, y, line, textColor);
+}
@@ -0,0 +1,42 @@
+// Performance overlay: a rolling frame-time graph and per-stage timings, built as a single mesh
+#pragma once
+
+#include "gpu_timer.h"
+#include "raycast.h"
+
+// Holds the measurements taken over one frame
+struct HudFrameStats {
+    float frameMs = 0.0f;       // Start of one frame to the start of the next
+    float simMs = 0.0f;         // Simulation and lightmap update
+    float castMs = 0.0f;        // Casting rays
+    float projectionMs = 0.0f;  // Building the projection mesh
+    float uploadMs = 0.0f;      // Buffer uploads
+    float drawMs = 0.0f;        // Draw call submission
+    float swapMs = 0.0f;        // Waiting in glfwSwapBuffers
+    float gpuMs = -1.0f;        // GPU time from timer queries, negative until a result is available
+    float gpuPassMs[gpuPassCount] = {}; // GPU time of each pass, summing to gpuMs
+    int rays = 0;               // Rays cast this frame
+    int wallRows = 0;           // Rows drawn per projection column
+    long long castSteps = 0;    // Grid steps taken by those rays
+    size_t uploadBytes = 0;     // Bytes passed to glBufferData
+};
+
+// Frames kept for the graph and averages
+const int hudHistory = 120;
+
+// Frame time at the top of the graph, in milliseconds
+const float hudGraphMaxMs = 50.0f;
+
+// Add a finished frame to the history
+void recordHudFrame(const HudFrameStats& stats);
+
+// Build the overlay (panel, graph and text) into mesh, in the same vertex format as the projection
+void generateHudMesh(VerticesIndices& mesh);
+
+// Which side limits the frame rate: "GPU-BOUND" when the GPU is busy for most of the frame,
+// "CPU-BOUND" when the CPU is, and "SYNC-BOUND" when both idle waiting on vsync or presentation.
+// gpuMs may be negative when no GPU time is known.
+const char* frameBottleneck(float frameMs, float cpuWaitMs, float gpuMs);
+
+// Print averages over every recorded frame, with the bottleneck verdict
+void printHudReport();
@@ -0,0 +1,83 @@
+// Indexed framebuffer upload and palette expansion
+#include "indexed_view.h"
+#include "shader.h"
+
+// Uniforms of the expansion shader, in the order given to loadShaderProgram()
+enum IndexedUniform { indexedProjectionRect };
+
+static ShaderProgram indexedShader;
+static GLuint indexedVAO = 0;
+static GLuint indexTexture = 0, paletteTexture = 0;
+static int indexRows = 0, indexColumns = 0; // Size indexTexture was allocated with
+
+// Texture units, set again whenever the shader is relinked
+static void bindIndexedUniforms(const ShaderProgram& program)
+{
+    glUniform1i(glGetUniformLocation(program.id, "indices"), 0);
+    glUniform1i(glGetUniformLocation(program.id, "palette"), 1);
+}
+
+bool initIndexedView()
+{
+    if (!loadShaderProgram(indexedShader, "fullscreen.vert", "indexed.frag", {"projectionRect"}, "", bindIndexedUniforms))
+        return false;
+
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_2D, paletteTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, paletteRamps * rampShades, 1, 0, GL_RGB, GL_FLOAT, palette);
+
+    glGenTextures(1, &indexTexture);
+    glBindTexture(GL_TEXTURE_2D, indexTexture);
+    // Integer textures can't be filtered; the shader picks the nearest pixel itself
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Core profile draws need a vertex array bound, even with no attributes
+    glGenVertexArrays(1, &indexedVAO);
+    return true;
+}
+
+size_t drawIndexedFramebuffer(const IndexedFramebuffer& framebuffer, const ViewLayout& layout)
+{
+    if (!indexedShader.id || framebuffer.pixels.empty())
+        return 0;
+
+    // Columns are contiguous in memory, so each column is a texture row: x is the row, y the column.
+    // Storage is only reallocated when the resolution changes.
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, indexTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (framebuffer.rows != indexRows || framebuffer.columns != indexColumns) {
+        indexRows = framebuffer.rows;
+        indexColumns = framebuffer.columns;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, indexRows, indexColumns, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, framebuffer.pixels.data());
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, indexRows, indexColumns, GL_RED_INTEGER, GL_UNSIGNED_BYTE, framebuffer.pixels.data());
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, paletteTexture);
+
+    glViewport(layout.projectionLeft, 0, layout.projectionWidth, layout.projectionHeight);
+    glUseProgram(indexedShader.id);
+    glUniform4f(indexedShader.uniforms[indexedProjectionRect], float(layout.projectionLeft), 0.0f,
+                float(layout.projectionWidth), float(layout.projectionHeight));
+    glBindVertexArray(indexedVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glViewport(0, 0, layout.width, layout.height);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    return framebuffer.pixels.size();
+}
+
+void shutdownIndexedView()
+{
+    GLuint textures[2] = {indexTexture, paletteTexture};
+    glDeleteTextures(2, textures);
+    glDeleteVertexArrays(1, &indexedVAO);
+    deleteShaderProgram(indexedShader);
+    indexRows = indexColumns = 0;
+}
@@ -0,0 +1,18 @@
+// Indexed framebuffer on screen: the CPU's 8-bit palette indices uploaded as a single-channel
+// texture each frame and expanded to colour through a palette texture in the fragment shader
+#pragma once
+
+#include "layout.h"
+#include "raycast.h"
+
+#include <cstddef>
+
+// Load shaders/indexed.frag and upload the palette. Needs a current GL context.
+// Returns false, after printing why, if the shader doesn't build.
+bool initIndexedView();
+
+// Upload framebuffer and draw it over the layout's projection area. Returns the bytes uploaded.
+size_t drawIndexedFramebuffer(const IndexedFramebuffer& framebuffer, const ViewLayout& layout);
+
+// Delete the program, textures and vertex array
+void shutdownIndexedView();
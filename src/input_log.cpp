@@ -0,0 +1,90 @@
+// Compact binary recordings of the buttons held on each simulation tick, for deterministic replays
+//
+// Layout (little endian):
+//   char[4]  magic "RCIN"
+//   uint32   version
+//   float    start x, start y, start rotation
+//   uint32   tick count
+//   runs of { uint16 buttons, uint16 ticks } until the tick count is reached
+#include "input_log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const char inputLogMagic[4] = {'R', 'C', 'I', 'N'};
+const uint32_t inputLogVersion = 1;
+
+bool saveInputLog(const std::string& path, const InputLog& log)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Could not write input log " << path << std::endl;
+        return false;
+    }
+
+    uint32_t tickCount = static_cast<uint32_t>(log.ticks.size());
+    std::fwrite(inputLogMagic, 1, sizeof(inputLogMagic), file);
+    std::fwrite(&inputLogVersion, sizeof(inputLogVersion), 1, file);
+    std::fwrite(&log.startX, sizeof(float), 1, file);
+    std::fwrite(&log.startY, sizeof(float), 1, file);
+    std::fwrite(&log.startRotation, sizeof(float), 1, file);
+    std::fwrite(&tickCount, sizeof(tickCount), 1, file);
+
+    // Buttons change rarely compared to the tick rate, so runs keep logs tiny
+    size_t i = 0;
+    while (i < log.ticks.size())
+    {
+        uint16_t buttons = log.ticks[i];
+        uint16_t run = 0;
+        while (i < log.ticks.size() && log.ticks[i] == buttons && run < UINT16_MAX)
+        {
+            ++run;
+            ++i;
+        }
+        std::fwrite(&buttons, sizeof(buttons), 1, file);
+        std::fwrite(&run, sizeof(run), 1, file);
+    }
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+bool loadInputLog(const std::string& path, InputLog& log)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cout << "Could not open input log " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, tickCount = 0;
+    bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              std::memcmp(magic, inputLogMagic, sizeof(magic)) == 0 &&
+              std::fread(&version, sizeof(version), 1, file) == 1 && version == inputLogVersion &&
+              std::fread(&log.startX, sizeof(float), 1, file) == 1 &&
+              std::fread(&log.startY, sizeof(float), 1, file) == 1 &&
+              std::fread(&log.startRotation, sizeof(float), 1, file) == 1 &&
+              std::fread(&tickCount, sizeof(tickCount), 1, file) == 1;
+
+    // tickCount is only trusted once the runs add up to it, so the ticks grow as they're read
+    // rather than being reserved up front from a header that may be corrupt
+    log.ticks.clear();
+    while (ok && log.ticks.size() < tickCount)
+    {
+        uint16_t buttons, run;
+        if (std::fread(&buttons, sizeof(buttons), 1, file) != 1 || std::fread(&run, sizeof(run), 1, file) != 1 ||
+            run == 0 || log.ticks.size() + run > tickCount) {
+            ok = false;
+            break;
+        }
+        log.ticks.insert(log.ticks.end(), run, buttons);
+    }
+    std::fclose(file);
+
+    if (!ok)
+        std::cout << "Malformed input log " << path << std::endl;
+    return ok;
+}
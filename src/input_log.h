@@ -0,0 +1,20 @@
+// Compact binary recordings of the buttons held on each simulation tick, for deterministic replays
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Holds a recording: the start pose and one button mask per simulation tick
+struct InputLog {
+    float startX = 0.0f;
+    float startY = 0.0f;
+    float startRotation = 0.0f;
+    std::vector<uint16_t> ticks;
+};
+
+// Write a recording as run-length encoded button masks. Returns false if the file can't be written.
+bool saveInputLog(const std::string& path, const InputLog& log);
+
+// Read a recording written by saveInputLog(). Returns false on a missing or malformed file.
+bool loadInputLog(const std::string& path, InputLog& log);
@@ -0,0 +1,21 @@
+// Window layout from the framebuffer size
+#include "layout.h"
+
+#include <algorithm>
+
+ViewLayout computeViewLayout(int framebufferWidth, int framebufferHeight, float scale)
+{
+    // A minimized window reports a zero size; keep every part at least a pixel across
+    ViewLayout layout;
+    layout.width = std::max(framebufferWidth, 2);
+    layout.height = std::max(framebufferHeight, 1);
+    layout.scale = scale > 0.0f ? scale : 1.0f;
+
+    layout.minimapSize = std::min(layout.height, layout.width / 2);
+    layout.minimapLeft = 0;
+    layout.minimapBottom = (layout.height - layout.minimapSize) / 2;
+    layout.projectionLeft = layout.minimapSize;
+    layout.projectionWidth = layout.width - layout.minimapSize;
+    layout.projectionHeight = layout.height;
+    return layout;
+}
@@ -0,0 +1,24 @@
+// Window layout: the minimap square at the left and the projection filling the rest, in
+// framebuffer pixels so HiDPI displays draw at full resolution. Recomputed whenever the
+// framebuffer changes size.
+#pragma once
+
+#include "minimap.h"
+#include "raycast.h"
+
+// Holds where each part of the window is drawn, in framebuffer pixels from the bottom left
+struct ViewLayout {
+    int width = windowWidth;   // Framebuffer size
+    int height = windowHeight;
+    float scale = 1.0f;        // Framebuffer pixels per window coordinate, 2 on most HiDPI displays
+    int minimapLeft = 0, minimapBottom = 0;
+    int minimapSize = minimapViewSize;                     // Side of the minimap square
+    int projectionLeft = minimapViewSize;
+    int projectionWidth = windowWidth - minimapViewSize;
+    int projectionHeight = windowHeight;                   // The projection spans the full height
+};
+
+// Layout for a framebuffer of the given size. The minimap is as large as fits in the height
+// and half the width, centred vertically; the projection takes the width to its right.
+// At the default window size this is the original 512 + 512 split.
+ViewLayout computeViewLayout(int framebufferWidth, int framebufferHeight, float scale);
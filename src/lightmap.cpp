@@ -0,0 +1,297 @@
+// Point lights baked into per-wall-face light levels, rebaked incrementally on a worker thread
+#include "lightmap.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Lights placed in the map: one in the nook behind the door, one in the open room
+std::vector<PointLight> lights = {
+    {128.0f, 416.0f, 240.0f, 14.0f},
+    {384.0f, 160.0f, 300.0f, 12.0f}
+};
+
+// Baked light for one map cell: lightmapSamples values for each of its 4 faces
+struct BakePatch {
+    int cell;
+    unsigned char values[4 * lightmapSamples];
+};
+
+// Cells to rebake, with snapshots of the lights and doors so the worker never
+// reads state the main thread is animating
+struct BakeJob {
+    std::vector<int> cells;
+    std::vector<PointLight> lights;
+    std::vector<Door> doors;
+};
+
+// Baked face light storage. Only cells that received light get a slot, so
+// large maps with few lights stay small.
+static std::vector<int> faceSlot;             // Slot per map cell, -1 if unlit
+static std::vector<unsigned char> faceLight;  // 4 * lightmapSamples values per slot
+
+// Background baker state
+static std::mutex bakeMutex;
+static std::condition_variable bakeWake;
+static std::deque<BakeJob> bakeQueue;
+static std::vector<BakePatch> finishedPatches;
+static bool bakeStop = false;
+static std::thread bakeThread;
+
+// Whether each door cast a shadow when the lightmap last saw it
+static std::vector<bool> doorShadowing;
+
+// Faces sample slightly in front of the wall so shadow rays don't start inside it
+const float faceOffset = 0.5f;
+
+static bool doorCastsShadow(const Door& door)
+{
+    return mapArray[door.cell] == tileThin || door.open < 0.5f;
+}
+
+// Bake the 4 faces of one cell against the lights and doors in a job
+static void bakeCell(const BakeJob& job, int cell, unsigned char* values)
+{
+    std::memset(values, 0, 4 * lightmapSamples);
+    int tile = mapArray[cell];
+    if (tile == 0)
+        return;
+
+    float cellL = (cell % mp) * sq;
+    float cellB = (mp - 1 - cell / mp) * sq;
+
+    // Door planes sit mid-cell and only have the two faces across their plane
+    const Door* door = nullptr;
+    if (tile == tileDoor || tile == tileThin)
+        door = findDoorIn(job.doors, cell);
+
+    for (int face = 0; face < 4; ++face)
+    {
+        bool faceX = face < 2; // West/east faces lie on a constant x
+        if (door && door->alongY != faceX)
+            continue;
+
+        float nx = face == 0 ? -1.0f : face == 1 ? 1.0f : 0.0f;
+        float ny = face == 2 ? -1.0f : face == 3 ? 1.0f : 0.0f;
+        float plane;
+        if (door)
+            plane = (faceX ? cellL : cellB) + sq / 2.0f;
+        else
+            plane = (faceX ? cellL : cellB) + (face == 1 || face == 3 ? sq : 0.0f);
+        plane += (faceX ? nx : ny) * faceOffset;
+
+        for (int s = 0; s < lightmapSamples; ++s)
+        {
+            float along = (s + 0.5f) / lightmapSamples * sq;
+            float px = faceX ? plane : cellL + along;
+            float py = faceX ? cellB + along : plane;
+
+            float sum = 0.0f;
+            for (const PointLight& light : job.lights)
+            {
+                float lx = light.x - px, ly = light.y - py;
+                float dist = std::sqrt(lx * lx + ly * ly);
+                if (dist >= light.radius || dist <= 0.0f)
+                    continue;
+                float facing = (lx * nx + ly * ny) / dist;
+                if (facing <= 0.0f)
+                    continue;
+                if (!gridLineOfSight(light.x, light.y, px, py, door ? cell : -1, job.doors))
+                    continue;
+                sum += light.intensity * (1.0f - dist / light.radius) * facing;
+            }
+            values[face * lightmapSamples + s] = static_cast<unsigned char>(std::min(sum + 0.5f, float(lightLevels - 1)));
+        }
+    }
+}
+
+// Collect the non-empty cells whose centre lies within radius (plus half a diagonal) of a point
+static void cellsInRadius(float x, float y, float radius, std::vector<int>& cells)
+{
+    float reach = radius + sq * 0.71f;
+    int minCol = std::max(0, int((x - reach) / sq)), maxCol = std::min(mp - 1, int((x + reach) / sq));
+    int minRow = std::max(0, int((y - reach) / sq)), maxRow = std::min(mp - 1, int((y + reach) / sq));
+    for (int row = minRow; row <= maxRow; ++row)
+    {
+        for (int col = minCol; col <= maxCol; ++col)
+        {
+            float cx = (col + 0.5f) * sq - x, cy = (row + 0.5f) * sq - y;
+            int cell = (mp - 1 - row) * mp + col;
+            if (cx * cx + cy * cy <= reach * reach && mapArray[cell] != 0)
+                cells.push_back(cell);
+        }
+    }
+}
+
+// Write a finished patch into face storage. Only on the thread that casts, as the cast reads it.
+static void applyPatch(const BakePatch& patch)
+{
+    int slot = faceSlot[patch.cell];
+    if (slot < 0) {
+        bool lit = std::any_of(std::begin(patch.values), std::end(patch.values),
+                               [](unsigned char v) { return v != 0; });
+        if (!lit)
+            return;
+        slot = static_cast<int>(faceLight.size() / (4 * lightmapSamples));
+        faceLight.resize(faceLight.size() + 4 * lightmapSamples);
+        faceSlot[patch.cell] = slot;
+    }
+    std::memcpy(&faceLight[slot * 4 * lightmapSamples], patch.values, sizeof(patch.values));
+}
+
+static void queueBake(std::vector<int> cells)
+{
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    if (cells.empty())
+        return;
+
+    BakeJob job;
+    job.cells = std::move(cells);
+    job.lights = lights;
+    job.doors = doors;
+    {
+        std::lock_guard<std::mutex> lock(bakeMutex);
+        bakeQueue.push_back(std::move(job));
+    }
+    bakeWake.notify_one();
+}
+
+static void bakeWorker()
+{
+    profilerThreadName("lightmap baker");
+    while (true)
+    {
+        BakeJob job;
+        {
+            std::unique_lock<std::mutex> lock(bakeMutex);
+            bakeWake.wait(lock, [] { return bakeStop || !bakeQueue.empty(); });
+            if (bakeStop)
+                return;
+            job = std::move(bakeQueue.front());
+            bakeQueue.pop_front();
+        }
+
+        PROFILE_ZONE("bake cells");
+        std::vector<BakePatch> patches(job.cells.size());
+        for (size_t i = 0; i < job.cells.size(); ++i)
+        {
+            patches[i].cell = job.cells[i];
+            bakeCell(job, job.cells[i], patches[i].values);
+        }
+
+        std::lock_guard<std::mutex> lock(bakeMutex);
+        finishedPatches.insert(finishedPatches.end(), patches.begin(), patches.end());
+    }
+}
+
+void initLightmap()
+{
+    faceSlot.assign(mp * mp, -1);
+    faceLight.clear();
+    // Rebakes left over from before a restart were against the old lights and doors
+    bakeQueue.clear();
+    finishedPatches.clear();
+
+    doorShadowing.clear();
+    for (const Door& door : doors)
+        doorShadowing.push_back(doorCastsShadow(door));
+
+    // The first bake happens up front so the first frame is already lit.
+    // Only cells some light can reach are baked, which keeps large maps cheap.
+    BakeJob job;
+    job.lights = lights;
+    job.doors = doors;
+    std::vector<int> cells;
+    for (const PointLight& light : lights)
+        cellsInRadius(light.x, light.y, light.radius, cells);
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    for (int cell : cells)
+    {
+        BakePatch patch;
+        patch.cell = cell;
+        bakeCell(job, cell, patch.values);
+        applyPatch(patch);
+    }
+
+    bakeStop = false;
+    bakeThread = std::thread(bakeWorker);
+}
+
+void moveLight(int index, float x, float y)
+{
+    PointLight& light = lights[index];
+    std::vector<int> cells;
+    cellsInRadius(light.x, light.y, light.radius, cells);
+    light.x = x;
+    light.y = y;
+    cellsInRadius(light.x, light.y, light.radius, cells);
+    queueBake(std::move(cells));
+}
+
+void queueDoorRebakes()
+{
+    PROFILE_ZONE("queue door rebakes");
+    // A door changing whether it casts a shadow only affects lights that can reach it
+    std::vector<int> cells;
+    for (size_t i = 0; i < doors.size(); ++i)
+    {
+        bool shadowing = doorCastsShadow(doors[i]);
+        if (shadowing == doorShadowing[i])
+            continue;
+        doorShadowing[i] = shadowing;
+
+        float doorX = (doors[i].cell % mp + 0.5f) * sq;
+        float doorY = (mp - 1 - doors[i].cell / mp + 0.5f) * sq;
+        for (const PointLight& light : lights)
+        {
+            float dx = light.x - doorX, dy = light.y - doorY;
+            if (dx * dx + dy * dy < (light.radius + sq) * (light.radius + sq))
+                cellsInRadius(light.x, light.y, light.radius, cells);
+        }
+    }
+    queueBake(std::move(cells));
+}
+
+void applyFinishedRebakes()
+{
+    PROFILE_ZONE("apply rebakes");
+    std::vector<BakePatch> patches;
+    {
+        std::lock_guard<std::mutex> lock(bakeMutex);
+        patches.swap(finishedPatches);
+    }
+    for (const BakePatch& patch : patches)
+        applyPatch(patch);
+}
+
+void updateLightmap()
+{
+    queueDoorRebakes();
+    applyFinishedRebakes();
+}
+
+int bakedFaceLight(int cell, int face, float wallX)
+{
+    int slot = cell < static_cast<int>(faceSlot.size()) ? faceSlot[cell] : -1;
+    if (slot < 0)
+        return 0;
+    int s = std::clamp(int(wallX * lightmapSamples), 0, lightmapSamples - 1);
+    return faceLight[(slot * 4 + face) * lightmapSamples + s];
+}
+
+void shutdownLightmap()
+{
+    {
+        std::lock_guard<std::mutex> lock(bakeMutex);
+        bakeStop = true;
+    }
+    bakeWake.notify_all();
+    if (bakeThread.joinable())
+        bakeThread.join();
+}
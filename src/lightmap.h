@@ -0,0 +1,38 @@
+// Point lights baked into per-wall-face light levels, rebaked incrementally on a worker thread
+#pragma once
+
+#include "raycast.h"
+
+// Holds a point light placed in the map
+struct PointLight {
+    float x, y;      // World position
+    float radius;    // Distance at which the light falls off to nothing
+    float intensity; // Light levels added right next to the light
+};
+
+const int lightmapSamples = 8; // Baked samples across each wall face
+
+// Lights placed in the map; move them with moveLight() so the lightmap follows
+extern std::vector<PointLight> lights;
+
+// Bake every face synchronously and start the background baker. After shutdownLightmap() it
+// can be called again to start over, with rebakes still queued from before dropped.
+void initLightmap();
+
+// Move a light and queue a rebake of the cells it leaves and enters
+void moveLight(int index, float x, float y);
+
+// Once per frame: queue rebakes for doors that changed shadowing and apply finished rebakes
+void updateLightmap();
+
+// The two halves of updateLightmap(), for when the simulation and the cast run on different
+// threads: queueDoorRebakes() reads the doors and lights the simulation owns, and
+// applyFinishedRebakes() writes the baked light the cast reads
+void queueDoorRebakes();
+void applyFinishedRebakes();
+
+// Baked light level on a face of a map cell (faces as in RayInfo::face), wallX in 0..1
+int bakedFaceLight(int cell, int face, float wallX);
+
+// Stop the background baker
+void shutdownLightmap();
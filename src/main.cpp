@@ -3,374 +3,155 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <cmath>
-
-// Vertex shader source code: handles position and color attributes
-const char* vertexShaderSource = "#version 330 core\n"
-"layout (location = 0) in vec3 aPos;\n"
-"layout (location = 1) in vec3 aColor;\n"
-"out vec3 vertexColor;\n"
-"uniform vec2 playerPos;\n"
-"void main()\n"
-"{\n"
-"   vec3 worldPos = aPos + vec3(playerPos, 0.0);\n"
-"   gl_Position = vec4(worldPos, 1.0);\n"
-"   vertexColor = aColor;\n"
-"}\0";
-
-// Fragment shader source code: outputs interpolated color
-const char* fragmentShaderSource = "#version 330 core\n"
-"in vec3 vertexColor;\n"
-"out vec4 FragColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(vertexColor, 1.0f);\n"
-"}\n\0";
-
-// Window and map configuration
-const int windowWidth = 1024;
-const int windowHeight = 512;
-const int sq = 64; // Width and height of each square in the grid
-const int mp = 8;  // Number of columns and rows in the map
-
-// Map layout (1=wall, 2/3=special, 0=empty)
-int mapArray[] = {
-    1,1,1,1,1,1,1,1,
-    1,0,0,2,0,0,0,1,
-    1,0,2,2,0,0,0,1,
-    1,0,0,0,0,0,0,1,
-    1,0,0,0,0,3,0,1,
-    1,0,0,0,0,3,0,1,
-    1,0,0,0,0,0,0,1,
-    1,1,1,1,1,1,1,1
-};
-
-
-// Player state
-float playerX = 256;
-float playerY = 256;
-float rotation = M_PI/2 + 0.01; // Player rotation in radians
-float speed = 0.5;       // Player movement speed
-float rotationSpeed = 0.03; // Player rotation speed
-int playerSize = 10;     // Player square size (for minimap)
-int numSlices = 128;     // Number of rays for raycasting/projection
-
-// Used for diagonal movement normalization
-const float sqrhf = sqrt(1.0f/2.0f);
-
-// Convert pixel X coordinate to normalized device coordinate (OpenGL)
-float pixelToScreenX(int x)
-{
-    return 2.0f * static_cast<float>(x) / windowWidth - 1.0f;
-}
-
-// Convert pixel Y coordinate to normalized device coordinate (OpenGL)
-float pixelToScreenY(int y)
-{
-    return 2.0f * static_cast<float>(y) / windowHeight - 1.0f;
-}
-
-// Generate rectangle vertices and colors in order: BL, BR, TL, TR (each with color)
-std::vector<float> generateRect(float lX, float rX, float bY, float tY, std::vector<float> color)
-{
-    std::vector<float> mapVertices;
-
-    // Bottom left vertex
-    mapVertices.push_back(lX);
-    mapVertices.push_back(bY);
-    mapVertices.push_back(0.0f);
-
-    // Color
-    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
-
-    // Bottom right vertex
-    mapVertices.push_back(rX);
-    mapVertices.push_back(bY);
-    mapVertices.push_back(0.0f);
-
-    // Color
-    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
-
-    // Top left vertex
-    mapVertices.push_back(lX);
-    mapVertices.push_back(tY);
-    mapVertices.push_back(0.0f);
-
-    // Color
-    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
-
-    // Top right vertex
-    mapVertices.push_back(rX);
-    mapVertices.push_back(tY);
-    mapVertices.push_back(0.0f);
-
-    // Color
-    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
-
-    return mapVertices;
-}
-
-// Holds both vertex and index data for OpenGL rendering
-struct VerticesIndices
-{
-    std::vector<float> vertices; // Interleaved vertex attributes (position, color)
-    std::vector<uint> indices;   // Indices for indexed drawing
-};
-
-// Generate all map square vertices (for minimap rendering)
-
-// Generate all map square indices (for minimap rendering)
-
-// Holds information about a single raycast hit
-struct RayInfo{
-    float distance; // Distance to the wall hit
-    float angle;    // Angle of the ray
-    int mapHit;     // Map info of the wall hit
-    bool hitEW;     // True if ray hit east/west wall, false if north/south
-};
-
-// Holds both the line vertices for ray visualization and hit info for projection
-struct RayLinesResult {
-    std::vector<float> lineVertices; // For OpenGL line drawing
-    std::vector<RayInfo> hitInfo;    // Hit info for projection
-};
-
-// Generate the 3D projection rectangles and indices for the right side of the window
-VerticesIndices generateProjectionInfo(std::vector<RayInfo> rayHitInfo)
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include "raycast.h"
+#include "game.h"
+#include "gpu_raycast.h"
+#include "gpu_timer.h"
+#include "hud.h"
+#include "indexed_view.h"
+#include "input_log.h"
+#include "layout.h"
+#include "lightmap.h"
+#include "minimap.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "resolution.h"
+#include "shader.h"
+#include "startup.h"
+#include "thread_pool.h"
+#include "voxel.h"
+
+// Uniforms of the basic shader, in the order given to loadShaderProgram()
+enum BasicUniform { basicPlayerPos, basicViewScale, basicViewOffset };
+
+// Sample the keyboard into a button mask for stepSimulation()
+unsigned sampleButtons(GLFWwindow* window)
 {
-    VerticesIndices projectionInfo;
-    projectionInfo.vertices.clear();
-    projectionInfo.indices.clear();
-
-    float ivar = (windowWidth - 512.0f) / numSlices;
-    float height_scalar = 0.5f;
-    int texSize = 16; // Number of vertical slices per wall
+    const struct { int key; unsigned button; } bindings[] = {
+        {GLFW_KEY_W, buttonForward}, {GLFW_KEY_S, buttonBack},
+        {GLFW_KEY_A, buttonLeft}, {GLFW_KEY_D, buttonRight},
+        {GLFW_KEY_LEFT, buttonTurnLeft}, {GLFW_KEY_RIGHT, buttonTurnRight},
+        {GLFW_KEY_E, buttonUse}, {GLFW_KEY_L, buttonLight},
+        {GLFW_KEY_T, buttonTerrain}, {GLFW_KEY_P, buttonSectors}
+    };
 
-    for (int i = 0; i < numSlices; ++i)
+    unsigned buttons = 0;
+    for (const auto& binding : bindings)
     {
-        RayInfo ray = rayHitInfo[i];
-        float start_x = 512.0f + i * ivar;
-        float dist = ray.distance;
-        bool sideV = !ray.hitEW; // True if vertical wall, False if horizontal
-        int map_type = ray.mapHit;
-        float rot = ray.angle;
-
-        float slice_height = 64.0f * windowHeight / dist * height_scalar;
-        float start_y = windowHeight / 2.0f - slice_height / 2.0f;
-        float y_slice = slice_height / texSize;
-
-        int tx = 0;
-        if (sideV) {
-            // Vertical wall: texture X coordinate
-            tx = int(fmod(ray.distance, 64.0f) / 4.0f);
-            if (rot < M_PI)
-                tx = 15 - tx;
-        } else {
-            // Horizontal wall: texture X coordinate
-            tx = int(fmod(ray.distance, 64.0f) / 4.0f);
-            if (rot > M_PI / 2.0f && rot < 3 * M_PI / 2.0f)
-                tx = 15 - tx;
-        }
-
-        for (int ty = 0; ty < texSize; ++ty)
-        {
-            float rect_top = start_y + ty * y_slice;
-            float rect_bottom = rect_top + y_slice + 1.0f;
-
-            // TODO: Replace with texture/color lookup if needed
-            std::vector<float> color;
-            if (sideV) color = { 1.0f, 1.0f, 1.0f };
-            else color = { 0.8f, 0.8f, 0.8f };
-
-            // Rectangle vertices (BL, BR, TL, TR)
-            float lX = pixelToScreenX((int)start_x);
-            float rX = pixelToScreenX((int)(start_x + ivar));
-            float bY = pixelToScreenY((int)rect_bottom);
-            float tY = pixelToScreenY((int)rect_top);
-
-            std::vector<float> rectVerts = generateRect(lX, rX, bY, tY, color);
-            uint vertOffset = projectionInfo.vertices.size() / 6; // 6 floats per vertex
-            projectionInfo.vertices.insert(projectionInfo.vertices.end(), rectVerts.begin(), rectVerts.end());
-
-            uint indices[6] = {
-                vertOffset + 0, vertOffset + 1, vertOffset + 2,
-                vertOffset + 2, vertOffset + 3, vertOffset + 1
-            };
-            projectionInfo.indices.insert(projectionInfo.indices.end(), std::begin(indices), std::end(indices));
-        }
+        if (glfwGetKey(window, binding.key) == GLFW_PRESS)
+            buttons |= binding.button;
     }
-    return projectionInfo;
+    return buttons;
 }
 
-std::vector<float> generatePlayerVertices()
-{
-    float halfWidth = (float)playerSize / windowWidth;
-    float halfHeight = (float)playerSize / windowHeight;
-
-    std::vector<float> color = {1.0f, 0.5f, 0.5f};
-
-    float lX = -halfWidth, rX = halfWidth;
-    float bY = -halfHeight, tY = halfHeight;
-
-    return generateRect(lX, rX, bY, tY, color);
-}
+using Clock = std::chrono::steady_clock;
 
-RayLinesResult generateRayLinesAndDistances() {
-    RayLinesResult result;
-    result.lineVertices.clear();
-    result.hitInfo.clear();
-
-    float fov = 1.7f; // FOV in radians (approx 97 degrees)
-    int half_range = numSlices / 2;
-    float pz = 0.0f;
-
-    for (int i = -half_range; i < half_range; ++i) {
-        RayInfo hitInfo;
-        float dtheta = fov * i * M_PI / 180.0f * (64.0f / numSlices);
-        float theta = rotation + dtheta;
-        hitInfo.angle = theta;
-        if (theta > 2 * M_PI) theta -= 2 * M_PI;
-        else if (theta < 0) theta += 2 * M_PI;
-        float tanth = tan(theta);
-        float atanth = 1.0f / tanth;
-
-        // --- Vertical grid intersections ---
-        float rx = playerX, ry = playerY;
-        float dx, dy;
-        if (theta < M_PI / 2.0f || theta > 3.0f * M_PI / 2.0f) {
-            rx = std::ceil(playerX / sq) * sq + 0.0001f;
-            dx = sq;
-        } else {
-            rx = std::floor(playerX / sq) * sq - 0.0001f;
-            dx = -sq;
-        }
-        ry = playerY + (rx - playerX) * tanth;
-        dy = dx * tanth;
-        if (ry > windowHeight) { ry = windowHeight; rx = playerX + (ry - playerY) * atanth; }
-        else if (ry < 0) { ry = 0; rx = playerX + (ry - playerY) * atanth; }
-        float vrx = rx, vry = ry;
-        while (true) {
-            int grid_x = int(vrx / sq);
-            int grid_y = int(mp - vry / sq);
-            if (grid_x < 0 || grid_x >= mp || grid_y < 0 || grid_y >= mp || mapArray[grid_y * mp + grid_x] != 0) {
-                hitInfo.mapHit = mapArray[grid_y * mp + grid_x];
-                break;
-            }
-            vrx += dx;
-            vry += dy;
-        }
-        std::pair<float, float> v_rayloc = {vrx, vry};
-
-        // --- Horizontal grid intersections ---
-        rx = playerX; ry = playerY;
-        if (theta < M_PI) {
-            ry = std::ceil(playerY / sq) * sq + 0.0001f;
-            dy = sq;
-        } else {
-            ry = std::floor(playerY / sq) * sq - 0.0001f;
-            dy = -sq;
-        }
-        rx = playerX + (ry - playerY) * atanth;
-        dx = dy * atanth;
-        if (rx > windowWidth) { rx = windowWidth; ry = playerY + (rx - playerX) * tanth; }
-        else if (rx < 0) { rx = 0; ry = playerY + (rx - playerX) * tanth; }
-        float hrx = rx, hry = ry;
-        while (true) {
-            int grid_x = int(hrx / sq);
-            int grid_y = int(mp - hry / sq);
-            if (grid_x < 0 || grid_x >= mp || grid_y < 0 || grid_y >= mp || mapArray[grid_y * mp + grid_x] != 0) {
-                hitInfo.mapHit = mapArray[grid_y * mp + grid_x];
-                break;
-            }
-            hrx += dx;
-            hry += dy;
-        }
-        std::pair<float, float> h_rayloc = {hrx, hry};
-
-        // --- Find shortest ray ---
-        float hx = h_rayloc.first, hy = h_rayloc.second;
-        float hdx = hx - playerX, hdy = hy - playerY;
-        float h_dist = std::sqrt(hdx * hdx + hdy * hdy) * std::cos(dtheta);
-
-        float vx = v_rayloc.first, vy = v_rayloc.second;
-        float vdx = vx - playerX, vdy = vy - playerY;
-        float v_dist = std::sqrt(vdx * vdx + vdy * vdy) * std::cos(dtheta);
-
-        float rx_final, ry_final;
-        if (h_dist < v_dist) {
-            rx_final = hx;
-            ry_final = hy;
-            hitInfo.distance = h_dist;
-            hitInfo.hitEW = true;
-        } else {
-            rx_final = vx;
-            ry_final = vy;
-            hitInfo.distance = v_dist;
-            hitInfo.hitEW = false;
-        }
-
-        // Convert to OpenGL screen space
-        float glStartX = pixelToScreenX((int)playerX);
-        float glStartY = pixelToScreenY((int)playerY);
-        float glEndX = pixelToScreenX((int)rx_final);
-        float glEndY = pixelToScreenY((int)ry_final);
-
-        // Line: player -> hit
-        result.lineVertices.insert(result.lineVertices.end(), {
-            glStartX, glStartY, pz, 1.0f, 1.0f, 1.0f,
-            glEndX,   glEndY,   pz, 1.0f, 1.0f, 1.0f
-        });
-        result.hitInfo.insert(result.hitInfo.begin(), hitInfo);
-    }
-    return result;
+float millisecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<float, std::milli>(end - start).count();
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+// Vertex array and buffer for the minimap ray lines, created when there are first lines to draw
+void createRayLineBuffers(GLuint& rayLinesVAO, GLuint& rayLinesVBO)
+{
+    glGenVertexArrays(1, &rayLinesVAO);
+    glGenBuffers(1, &rayLinesVBO);
+    glBindVertexArray(rayLinesVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, rayLinesVBO);
+    // Initially empty, each ray line is uploaded with glBufferData as it's drawn
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+    // Position attribute (location 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // Color attribute (location 1)
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
-void movePlayer(float signfb, float signlr) {
-    if (signfb != 0.0f || signlr != 0.0f) {
-        float dx = speed * cos(rotation) * signfb;
-        float dy = speed * sin(rotation) * signfb;
-        int grid_x = int((playerX + 8 * dx) / 64); // collision detection
-        int grid_y = int(mp - (playerY + 8 * dy) / 64);
-        if (mapArray[grid_y * mp + grid_x] != 0) {
-            return;
-        }
-        playerX += dx;
-        playerY += dy;
-
-        dx = speed * cos(rotation + M_PI/2) * signlr;
-        dy = speed * sin(rotation + M_PI/2) * signlr;
-        grid_x = int((playerX + 8 * dx) / 64); // collision detection
-        grid_y = int(mp - (playerY + 8 * dy) / 64);
-        if (mapArray[grid_y * mp + grid_x] != 0) {
-            return;
-        }
-        playerX += dx;
-        playerY += dy;
-    }
+// Layout for the window's framebuffer as it is now. HiDPI framebuffers have more pixels than
+// the window has coordinates; the content scale says how many per coordinate.
+ViewLayout windowLayout(GLFWwindow* window)
+{
+    int framebufferWidth, framebufferHeight;
+    float scaleX = 1.0f, scaleY = 1.0f;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glfwGetWindowContentScale(window, &scaleX, &scaleY);
+    return computeViewLayout(framebufferWidth, framebufferHeight, std::max(scaleX, scaleY));
 }
 
-void turnPlayer(float dir) {
-    rotation += rotationSpeed * dir;
-    if (rotation < 0) {
-        rotation += 2 * M_PI;
-    } else if (rotation > 2 * M_PI) {
-        rotation -= 2 * M_PI;
+int main(int argc, char** argv)
+{
+    // --record <file> writes the buttons held on every frame for raycast_replay
+    // --trace <file> records timing zones and writes them as Chrome trace JSON on exit
+    // --perf-report prints CPU and GPU frame time averages and whether the run was CPU- or GPU-bound
+    // --perf-counters prints hardware counters per frame stage on exit (Linux)
+    // --serial runs the simulation and cast on the main thread instead of their own threads
+    // --frame-budget <ms> is the frame time the dynamic resolution keeps under (default 60 Hz)
+    // --fixed-resolution keeps the default 128 columns instead of adapting them to the budget
+    // --gpu-raycast starts with the projection cast per pixel on the GPU instead of on the CPU
+    // --indexed starts with the projection drawn as 8-bit palette indices expanded on the GPU
+    // --fov <degrees> sets the horizontal field of view (default 90, walls in proportion)
+    // --startup-report prints how long each startup stage took, up to the first frame on screen
+    std::string recordPath, tracePath;
+    bool perfReport = false;
+    bool perfCounters = false;
+    bool serial = false;
+    bool fixedResolution = false;
+    ProjectionPath projectionPath = projectionMesh;
+    bool startupReport = false;
+    float frameBudgetMs = 1000.0f / 60.0f;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--perf-report") == 0)
+            perfReport = true;
+        else if (std::strcmp(argv[i], "--perf-counters") == 0)
+            perfCounters = true;
+        else if (std::strcmp(argv[i], "--serial") == 0)
+            serial = true;
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc)
+            frameBudgetMs = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--fov") == 0 && i + 1 < argc)
+            setFieldOfView(static_cast<float>(std::atof(argv[++i])));
+        else if (std::strcmp(argv[i], "--fixed-resolution") == 0)
+            fixedResolution = true;
+        else if (std::strcmp(argv[i], "--gpu-raycast") == 0)
+            projectionPath = projectionGpu;
+        else if (std::strcmp(argv[i], "--indexed") == 0)
+            projectionPath = projectionIndexed;
+        else if (std::strcmp(argv[i], "--startup-report") == 0)
+            startupReport = true;
     }
-}
+    profilerThreadName("main");
+    // Counters are read by the profiler's zones, so they need the zones running
+    if (perfCounters)
+        perfCounters = initPerfCounters();
+    // Counters are per thread, so count every stage by running them all on this one
+    if (perfCounters)
+        serial = true;
+    profilerEnabled = !tracePath.empty() || perfCounters;
 
-int main()
-{
     // Initialize GLFW
     if (!glfwInit())
         return -1;
+    finishStartupStage(startupGlfw);
 
     // Give GLFW context for which OpenGL versions and profile we are using
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // CORE contains all the modern functions
+    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE); // Same size on screen on HiDPI monitors outside macOS
 
     // Declare GLFW window with params (width, height, title, fullscreen y/n, and irrelevant)
     GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Raycast", nullptr, nullptr);
@@ -382,48 +163,64 @@ int main()
     
     // Update context of window to be current
     glfwMakeContextCurrent(window);
+    finishStartupStage(startupContext);
 
     // Load GLAD
     gladLoadGL();
+    finishStartupStage(startupGlad);
 
-    int framebufferWidth, framebufferHeight;
-    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
-    glViewport(0, 0, framebufferWidth, framebufferHeight);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // 1. Create vertex shader object and get reference
-    // 2. Attach vertex shader source to the vertex shader object
-    // 3. Compile the vertex shader into machine code
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-
-    // 1. Create fragment shader object and get its reference
-    // 2. Attach fragment shader source to the fragment shader object
-    // 3. Compile the vertex shader into machine code
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
-
-    // 1. Create shader program object and get its reference
-    // 2. Attach the vertex and fragment shaders to the shader program
-    // 3. Wrap up / link all the shaders together into the shader program
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Delete the now useless shader objects
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // WHOLE GOAL of this part was to create the shaderProgram:
-    // Had to create vertex and frag shaders, attach them, then delete them once no longer needed
-
-
-    // Map vertices and indices
-    std::vector<float> mapVertices = generateMapVertices();
-    std::vector<uint> mapIndices = generateMapIndices();
+    // Each part of the window is drawn in its own viewport, placed by the layout
+    ViewLayout layout = windowLayout(window);
+
+    // Position and colour shader for everything but the GPU raycaster, from shaders/basic.*
+    ShaderProgram basicShader;
+    if (!loadShaderProgram(basicShader, "basic.vert", "basic.frag", {"playerPos", "viewScale", "viewOffset"}))
+    {
+        glfwTerminate();
+        return -1;
+    }
+    finishStartupStage(startupShaders);
+
+    // Doors, shading tables, lightmap, terrain and sector world
+    initGame();
+
+    InputLog inputLog;
+    inputLog.startX = player.x;
+    inputLog.startY = player.y;
+    inputLog.startRotation = player.rotation;
+
+    // Minimap merged into rectangles, uploaded once and patched when doors open or close
+    MinimapMesh minimap;
+    buildMinimapMesh(minimap, doors);
+    std::vector<uint> mapIndices = generateQuadIndices(minimap.quads);
+    std::vector<MinimapRange> minimapRanges;
+    std::vector<MinimapDraw> minimapDraws;
+    std::vector<GLsizei> minimapCounts;
+    std::vector<const void*> minimapOffsets;
+    finishStartupStage(startupMap);
+
+    // The minimap viewport follows the player; - and = zoom out and in
+    float minimapZoom = 1.0f;
+    bool zoomOutHeld = false, zoomInHeld = false;
+
+    // The GPU raycaster and the indexed view are set up the first time they're switched on, and
+    // stay off if their shaders don't build here
+    bool gpuRaycasterTried = false, gpuRaycasterReady = false;
+    bool indexedViewTried = false, indexedViewReady = false;
+    auto projectionPathReady = [&](ProjectionPath path) {
+        if (path == projectionGpu && !gpuRaycasterTried) {
+            gpuRaycasterTried = true;
+            gpuRaycasterReady = initGpuRaycaster();
+        }
+        if (path == projectionIndexed && !indexedViewTried) {
+            indexedViewTried = true;
+            indexedViewReady = initIndexedView();
+        }
+        return path == projectionGpu ? gpuRaycasterReady : path == projectionIndexed ? indexedViewReady : true;
+    };
+    if (!projectionPathReady(projectionPath))
+        projectionPath = projectionMesh;
+    bool gpuKeyHeld = false, indexedKeyHeld = false;
 
     // Create reference containers for the Vertex Array Object and the Vertex Buffer Object
     GLuint mapVAO, mapVBO, mapEBO;
@@ -439,7 +236,7 @@ int main()
     // 1. Bind the VBO specifying that it's a GL_ARRAY_BUFFER
     // 2. Introduce the vertices into the VBO
     glBindBuffer(GL_ARRAY_BUFFER, mapVBO);
-    glBufferData(GL_ARRAY_BUFFER, mapVertices.size() * sizeof(float), mapVertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, minimap.vertices.size() * sizeof(float), minimap.vertices.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mapEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, mapIndices.size() * sizeof(unsigned int), mapIndices.data(), GL_STATIC_DRAW);
@@ -491,30 +288,9 @@ int main()
     glEnableVertexAttribArray(1);
 
 
-    // Ray lines result which contains vertices and distances
-    RayLinesResult rayLinesResult;
-    std::vector<float> rayLineVertices; // Format: [x0, y0, z0, r0, g0, b0, x1, y1, z1, r1, g1, b1, ...]
-    std::vector<RayInfo> rayHitInfo; // Raycast hit info for projection
-
-    // Create reference containers for rayLines VAO and VBO
-    GLuint rayLinesVAO, rayLinesVBO;
+    // Ray lines are drawn only in the grid view, so their buffers wait for the first lines
+    GLuint rayLinesVAO = 0, rayLinesVBO = 0;
 
-    glGenVertexArrays(1, &rayLinesVAO);
-    glGenBuffers(1, &rayLinesVBO);
-    glBindVertexArray(rayLinesVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, rayLinesVBO);
-    // Initially empty, user will update rayLineVertices and glBufferData as needed
-    glBufferData(GL_ARRAY_BUFFER, rayLineVertices.size() * sizeof(float), rayLineVertices.data(), GL_STATIC_DRAW);
-    // Position attribute (location 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Color attribute (location 1)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    
     // Projection vertices and indices
     std::vector<float> projectionVertices;
     std::vector<float> projectionIndices;
@@ -548,69 +324,203 @@ int main()
 
 
 
+    // Performance overlay, rebuilt and uploaded every frame
+    VerticesIndices hudMesh;
+    GLuint hudVAO, hudVBO, hudEBO;
+    glGenVertexArrays(1, &hudVAO);
+    glGenBuffers(1, &hudVBO);
+    glGenBuffers(1, &hudEBO);
+    glBindVertexArray(hudVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, hudVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hudEBO);
+    // Position attribute (location 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // Color attribute (location 1)
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // GPU time per pass. Results are read a few frames late so reading them never stalls.
+    initGpuTimers();
+    long long frameIndex = 0;
+
+    bool showHud = true;
+    bool hudKeyHeld = false;
+    HudFrameStats stats;
+    Clock::time_point frameStart = Clock::now();
+    Clock::time_point shaderCheck = frameStart;
+
+    // Simulation and cast run ahead on their own threads; this thread only uploads and draws
+    setProjectionPath(projectionPath);
+    startPipeline(!serial, recordPath.empty() ? nullptr : &inputLog);
+
+    // Columns and rows per column follow the measured frame cost
+    ResolutionController resolution;
+    resolution.budgetMs = frameBudgetMs;
+    resolution.pipelined = !serial;
+    requestProjectionSize(layout.projectionWidth, layout.projectionHeight);
+    requestResolution(resolutionForWidth(resolution.level, layout.projectionWidth));
+
+
     // Bind both the VBO, VAO, and EBO to 0 so we don't accidentally modify them
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    finishStartupStage(startupBuffers);
 
-
-    // 1. Specify background color
-    // 2. Clean back buffer and assign new color
-    // 3. Swap back buffer with front buffer
-    glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glfwSwapBuffers(window);
+    // No blank frame is presented first: the first loop iteration clears and draws a real one,
+    // so startup doesn't wait a vsync for nothing
 
     // Loop for while window is open
     while (!glfwWindowShouldClose(window))
     {
-        glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        float signfb = 0;
-        float signlr = 0;
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-            signfb += 1.0f;
-        }
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-            signlr += 1.0f;
-        }
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-            signfb -= 1.0f;
-        }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-            signlr -= 1.0f;
+        PROFILE_ZONE("frame");
+
+        // The previous frame ends where this one starts
+        Clock::time_point now = Clock::now();
+        if (frameIndex > 0) {
+            stats.frameMs = millisecondsBetween(frameStart, now);
+            recordHudFrame(stats);
+
+            // Rendering costs the larger of its CPU submission and GPU time, which arrives a few frames late
+            float renderMs = std::max(stats.uploadMs + stats.drawMs, stats.gpuMs);
+            if (!fixedResolution && updateResolution(resolution, stats.castMs + stats.projectionMs, renderMs))
+                requestResolution(resolutionForWidth(resolution.level, layout.projectionWidth));
         }
-        if (signfb != 0 && signlr != 0) {
-            signfb *= sqrhf;
-            signlr *= sqrhf;
+        frameStart = now;
+        stats = HudFrameStats();
+
+        // Shader files edited while running are rebuilt, checked a few times a second
+        if (now - shaderCheck > std::chrono::milliseconds(250)) {
+            PROFILE_ZONE("reload shaders");
+            reloadChangedShaders();
+            shaderCheck = now;
         }
-        movePlayer(signfb, signlr);
 
-        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-            turnPlayer(1);
-        }
-        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-            turnPlayer(-1);
+        // H toggles the performance overlay. It isn't part of the simulation, so it isn't recorded.
+        bool hudKey = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+        if (hudKey && !hudKeyHeld) showHud = !showHud;
+        hudKeyHeld = hudKey;
+
+        // Zooming is a view setting like the overlay, so it isn't recorded either
+        bool zoomOut = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+        bool zoomIn = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+        if (zoomOut && !zoomOutHeld) minimapZoom = std::max(minimapZoom / 1.5f, minimapMinZoom());
+        if (zoomIn && !zoomInHeld) minimapZoom = std::min(minimapZoom * 1.5f, minimapMaxZoom);
+        zoomOutHeld = zoomOut;
+        zoomInHeld = zoomIn;
+
+        // G switches the projection to the GPU raycaster and I to the indexed framebuffer, each
+        // back to the CPU mesh when pressed again; also view settings
+        bool gpuKey = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+        bool indexedKey = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+        ProjectionPath wantedPath = projectionPath;
+        if (gpuKey && !gpuKeyHeld)
+            wantedPath = projectionPath == projectionGpu ? projectionMesh : projectionGpu;
+        if (indexedKey && !indexedKeyHeld)
+            wantedPath = projectionPath == projectionIndexed ? projectionMesh : projectionIndexed;
+        if (wantedPath != projectionPath && projectionPathReady(wantedPath)) {
+            projectionPath = wantedPath;
+            setProjectionPath(projectionPath);
         }
+        gpuKeyHeld = gpuKey;
+        indexedKeyHeld = indexedKey;
+
+        // Hand the buttons to the simulation and take the frame cast while the last one was drawn
+        submitButtons(sampleButtons(window));
+        const FramePacket& packet = acquireFrame();
+        const FrameOutput& frame = packet.frame;
+        const std::vector<float>& rayLineVertices = frame.rays.lineVertices;
+        stats.simMs = packet.simMs;
+        stats.castMs = frame.castMs;
+        stats.projectionMs = frame.projectionMs;
+        stats.rays = static_cast<int>(frame.rays.hitInfo.size());
+        stats.wallRows = frame.wallRows;
+        stats.castSteps = frame.rays.castSteps;
+        Clock::time_point stageStart = Clock::now();
 
         // Tell OpenGL which shader program we want to use
-        glUseProgram(shaderProgram);
-        GLint playerPosLocation = glGetUniformLocation(shaderProgram, "playerPos");
+        glUseProgram(basicShader.id);
+        GLint playerPosLocation = basicShader.uniforms[basicPlayerPos];
+        GLint viewScaleLocation = basicShader.uniforms[basicViewScale];
+        GLint viewOffsetLocation = basicShader.uniforms[basicViewOffset];
+
+        // The minimap, its ray lines and the player marker go through the viewport transform
+        // and are clipped to the viewport; everything else is drawn as built
+        MinimapView minimapView = minimapViewAt(frame.camera.x, frame.camera.y, minimapZoom);
+        float viewScale[2], viewOffset[2];
+        minimapViewTransform(minimapView, viewScale, viewOffset);
+
+        // A resize lays the window out again and asks for frames cast at the new size. The cast
+        // rebuilds its column tables once, with the first frame at the new column count.
+        ViewLayout resized = windowLayout(window);
+        if (resized.width != layout.width || resized.height != layout.height || resized.scale != layout.scale) {
+            layout = resized;
+            requestProjectionSize(layout.projectionWidth, layout.projectionHeight);
+            requestResolution(resolutionForWidth(resolution.level, layout.projectionWidth));
+        }
+        glViewport(layout.minimapLeft, layout.minimapBottom, layout.minimapSize, layout.minimapSize);
+        glScissor(layout.minimapLeft, layout.minimapBottom, layout.minimapSize, layout.minimapSize);
+
+        // Patch the chunks of the minimap where a door opened or closed. Only when a chunk
+        // outgrew its spare room is the whole mesh uploaded again.
+        if (updateMinimapMesh(minimap, packet.doors, minimapRanges)) {
+            PROFILE_ZONE("patch minimap");
+            glBindVertexArray(mapVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, mapVBO);
+            if (minimapRanges.empty()) {
+                mapIndices = generateQuadIndices(minimap.quads);
+                glBufferData(GL_ARRAY_BUFFER, minimap.vertices.size() * sizeof(float), minimap.vertices.data(), GL_DYNAMIC_DRAW);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, mapIndices.size() * sizeof(unsigned int), mapIndices.data(), GL_STATIC_DRAW);
+                stats.uploadBytes += minimap.vertices.size() * sizeof(float) + mapIndices.size() * sizeof(unsigned int);
+            }
+            for (const MinimapRange& range : minimapRanges)
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(float), range.count * sizeof(float), &minimap.vertices[range.first]);
+                stats.uploadBytes += range.count * sizeof(float);
+            }
+            Clock::time_point patched = Clock::now();
+            stats.uploadMs += millisecondsBetween(stageStart, patched);
+            stageStart = patched;
+        }
 
         // Bind the map VAO so OpenGL knows to use it
         // Draw the triangle using the GL_TRIANGLES primitive
-        glUniform2f(playerPosLocation, 0.0f, 0.0f);
-        glBindVertexArray(mapVAO);
-        glDrawElements(GL_TRIANGLES, mapIndices.size(), GL_UNSIGNED_INT, 0);
+        // The clear sits next to the map draw so the GPU pass doesn't span the simulation
+        {
+            PROFILE_ZONE("draw map");
+            beginGpuPass(gpuPassMap);
+            glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glUniform2f(playerPosLocation, 0.0f, 0.0f);
+            glUniform2f(viewScaleLocation, viewScale[0], viewScale[1]);
+            glUniform2f(viewOffsetLocation, viewOffset[0], viewOffset[1]);
+            glEnable(GL_SCISSOR_TEST);
+
+            // Only the chunks in view, one run of quads per chunk row, in a single call
+            cullMinimapChunks(minimap, minimapView, minimapDraws);
+            minimapCounts.clear();
+            minimapOffsets.clear();
+            for (const MinimapDraw& draw : minimapDraws)
+            {
+                minimapCounts.push_back(draw.quads * 6);
+                minimapOffsets.push_back(reinterpret_cast<const void*>(size_t(draw.firstQuad) * 6 * sizeof(unsigned int)));
+            }
+            glBindVertexArray(mapVAO);
+            glMultiDrawElements(GL_TRIANGLES, minimapCounts.data(), GL_UNSIGNED_INT, minimapOffsets.data(), static_cast<GLsizei>(minimapCounts.size()));
+            endGpuPass();
+        }
+        stats.drawMs += millisecondsBetween(stageStart, Clock::now());
 
-        // Generate rayLineVertices
-        rayLinesResult = generateRayLinesAndDistances();
-        rayLineVertices = rayLinesResult.lineVertices;
-        rayHitInfo = rayLinesResult.hitInfo;
+        // Ray lines are uploaded and drawn one at a time, so their time counts as upload
+        stageStart = Clock::now();
 
         // Draw rays from player to each endpoint in rayLineVertices
         if (!rayLineVertices.empty()) {
+            PROFILE_ZONE("upload and draw ray lines");
+            if (!rayLinesVAO)
+                createRayLineBuffers(rayLinesVAO, rayLinesVBO);
+            beginGpuPass(gpuPassRays);
             glBindBuffer(GL_ARRAY_BUFFER, rayLinesVBO);
             glBindVertexArray(rayLinesVAO);
             for (size_t i = 0; i < rayLineVertices.size(); i += 6) {
@@ -618,8 +528,8 @@ int main()
                 float endY = rayLineVertices[i+1];
                 float endZ = rayLineVertices[i+2];
                 // Color is at i+3, i+4, i+5
-                float startX = pixelToScreenX((int)playerX);
-                float startY = pixelToScreenY((int)playerY);
+                float startX = pixelToScreenX((int)frame.camera.x);
+                float startY = pixelToScreenY((int)frame.camera.y);
                 float startZ = 0.0f;
                 float colorR = rayLineVertices[i+3];
                 float colorG = rayLineVertices[i+4];
@@ -630,52 +540,132 @@ int main()
                 };
                 glBufferData(GL_ARRAY_BUFFER, sizeof(lineVerts), lineVerts, GL_DYNAMIC_DRAW);
                 glDrawArrays(GL_LINES, 0, 2);
+                stats.uploadBytes += sizeof(lineVerts);
             }
             glBindVertexArray(0);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
+            endGpuPass();
         }
+        glDisable(GL_SCISSOR_TEST);
+        glUniform2f(viewScaleLocation, 1.0f, 1.0f);
+        glUniform2f(viewOffsetLocation, 0.0f, 0.0f);
+
+
+        // The projection pass includes its upload, which the GPU has to copy before drawing.
+        // Frames left to the GPU raycaster upload only the doors that moved and cast per pixel;
+        // indexed frames upload one byte per pixel and expand it through the palette on the GPU.
+        beginGpuPass(gpuPassProjection);
+        if (frame.path == projectionGpu) {
+            {
+                PROFILE_ZONE("upload doors");
+                updateGpuRaycasterDoors(packet.doors);
+            }
+            stats.uploadMs += millisecondsBetween(stageStart, Clock::now());
+            stageStart = Clock::now();
+
+            PROFILE_ZONE("draw gpu raycast");
+            drawGpuRaycast(frame.camera, layout);
+            glUseProgram(basicShader.id);
+        } else if (frame.path == projectionIndexed) {
+            PROFILE_ZONE("draw indexed projection");
+            stats.uploadBytes += drawIndexedFramebuffer(frame.indexed, layout);
+            stats.uploadMs += millisecondsBetween(stageStart, Clock::now());
+            stageStart = Clock::now();
+            glUseProgram(basicShader.id);
+        } else {
+            // Bind the projection VAO so OpenGL knows to use it
+            // Projection vertices and indices were generated by buildFrame()
+            const VerticesIndices& projectionInfo = frame.projection;
+            {
+                PROFILE_ZONE("upload projection");
+                stats.uploadBytes += projectionInfo.vertices.size() * sizeof(float) + projectionInfo.indices.size() * sizeof(unsigned int);
+                glBindBuffer(GL_ARRAY_BUFFER, projectionVBO);
+                glBufferData(GL_ARRAY_BUFFER, projectionInfo.vertices.size() * sizeof(float), projectionInfo.vertices.data(), GL_STATIC_DRAW);
+
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, projectionEBO);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, projectionInfo.indices.size() * sizeof(unsigned int), projectionInfo.indices.data(), GL_STATIC_DRAW);
+            }
 
+            stats.uploadMs += millisecondsBetween(stageStart, Clock::now());
+            stageStart = Clock::now();
 
-        // Bind the projection VAO so OpenGL knows to use it
-        // Generate projection vertices and indices
-        VerticesIndices projectionInfo = generateProjectionInfo(rayHitInfo);
-
-        glBindBuffer(GL_ARRAY_BUFFER, projectionVBO);
-        glBufferData(GL_ARRAY_BUFFER, projectionInfo.vertices.size() * sizeof(float), projectionInfo.vertices.data(), GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, projectionEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, projectionInfo.indices.size() * sizeof(unsigned int), projectionInfo.indices.data(), GL_STATIC_DRAW);
-
-        glBindVertexArray(projectionVAO);
-        glDrawElements(GL_TRIANGLES, projectionInfo.indices.size(), GL_UNSIGNED_INT, 0);
+            PROFILE_ZONE("draw projection");
+            glViewport(layout.projectionLeft, 0, layout.projectionWidth, layout.projectionHeight);
+            glBindVertexArray(projectionVAO);
+            glDrawElements(GL_TRIANGLES, projectionInfo.indices.size(), GL_UNSIGNED_INT, 0);
+        }
+        endGpuPass();
 
 
         // Bind the VAO so OpenGL knows to use it
         // Draw the triangle using the GL_TRIANGLES primitive
-        float offX = pixelToScreenX((int)playerX);
-        float offY = pixelToScreenY((int)playerY);
-        glUniform2f(playerPosLocation, offX, offY);
+        // The marker keeps its size in window pixels at any zoom or minimap size, so only its
+        // position goes through the view; its vertices are scaled into the minimap's viewport
+        float offX = pixelToScreenX((int)frame.camera.x) * viewScale[0] + viewOffset[0];
+        float offY = pixelToScreenY((int)frame.camera.y) * viewScale[1] + viewOffset[1];
+        beginGpuPass(gpuPassPlayer);
+        glViewport(layout.minimapLeft, layout.minimapBottom, layout.minimapSize, layout.minimapSize);
+        glUniform2f(playerPosLocation, 0.0f, 0.0f);
+        glUniform2f(viewScaleLocation, windowWidth * layout.scale / layout.minimapSize, windowHeight * layout.scale / layout.minimapSize);
+        glUniform2f(viewOffsetLocation, offX, offY);
         glBindVertexArray(playerVAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        endGpuPass();
+        stats.drawMs += millisecondsBetween(stageStart, Clock::now());
+
+        // Performance overlay in one draw, showing the frames before this one
+        if (showHud) {
+            PROFILE_ZONE("hud");
+            stageStart = Clock::now();
+            generateHudMesh(hudMesh);
+            beginGpuPass(gpuPassHud);
+            glBindVertexArray(hudVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, hudVBO);
+            glBufferData(GL_ARRAY_BUFFER, hudMesh.vertices.size() * sizeof(float), hudMesh.vertices.data(), GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, hudMesh.indices.size() * sizeof(unsigned int), hudMesh.indices.data(), GL_STREAM_DRAW);
+            stats.uploadBytes += hudMesh.vertices.size() * sizeof(float) + hudMesh.indices.size() * sizeof(unsigned int);
+            Clock::time_point uploaded = Clock::now();
+            stats.uploadMs += millisecondsBetween(stageStart, uploaded);
+
+            // The overlay is built in window coordinates and keeps its size on screen, anchored
+            // to the top left corner
+            glViewport(0, layout.height - int(windowHeight * layout.scale), int(windowWidth * layout.scale), int(windowHeight * layout.scale));
+            glUniform2f(viewScaleLocation, 1.0f, 1.0f);
+            glUniform2f(viewOffsetLocation, 0.0f, 0.0f);
+            glDrawElements(GL_TRIANGLES, hudMesh.indices.size(), GL_UNSIGNED_INT, 0);
+            endGpuPass();
+            stats.drawMs += millisecondsBetween(uploaded, Clock::now());
+        }
 
-        glfwSwapBuffers(window);
+        // Pick up the GPU pass times of the oldest frame in the ring if it has finished.
+        // The GPU busy time is the sum of the passes, a few frames behind the CPU stats.
+        if (finishGpuFrame(stats.gpuPassMs)) {
+            stats.gpuMs = 0.0f;
+            for (float passMs : stats.gpuPassMs)
+                stats.gpuMs += passMs;
+        }
+        ++frameIndex;
+
+        {
+            PROFILE_ZONE("swap buffers");
+            stageStart = Clock::now();
+            glfwSwapBuffers(window);
+            stats.swapMs = millisecondsBetween(stageStart, Clock::now());
+        }
+        // With the first frame up, work it didn't need can start in the background
+        if (frameIndex == 1) {
+            finishStartupStage(startupFirstFrame);
+            pregenerateTerrain();
+        }
 
         // Process window events
+        PROFILE_ZONE("poll events");
         glfwPollEvents();
-
-        // // Print FPS
-        //
-        // static double lastTime = glfwGetTime();
-        // static int nbFrames = 0;
-        // nbFrames++;
-        // double currentTime = glfwGetTime();
-        // if (currentTime - lastTime >= 1.0) {
-        //     std::cout << "FPS: " << nbFrames << std::endl;
-        //     nbFrames = 0;
-        //     lastTime += 1.0;
-        // }
     }
 
+    // Stop the simulation and cast before anything they use goes away
+    stopPipeline();
+
     // Delete objects we've created
     glDeleteVertexArrays(1, &rayLinesVAO);
     glDeleteBuffers(1, &rayLinesVBO);
@@ -685,7 +675,34 @@ int main()
     glDeleteVertexArrays(1, &playerVAO);
     glDeleteBuffers(1, &playerVBO);
     glDeleteBuffers(1, &playerEBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteVertexArrays(1, &hudVAO);
+    glDeleteBuffers(1, &hudVBO);
+    glDeleteBuffers(1, &hudEBO);
+    shutdownGpuTimers();
+    if (gpuRaycasterReady)
+        shutdownGpuRaycaster();
+    if (indexedViewReady)
+        shutdownIndexedView();
+    deleteShaderProgram(basicShader);
+    shutdownLightmap();
+    shutdownWorkers();
+
+    if (!recordPath.empty() && saveInputLog(recordPath, inputLog)) {
+        std::cout << "Recorded " << inputLog.ticks.size() << " ticks to " << recordPath << std::endl;
+    }
+    if (perfReport) {
+        printHudReport();
+    }
+    if (startupReport) {
+        printStartupReport();
+    }
+    if (perfCounters) {
+        printPerfReport(frameIndex);
+        shutdownPerfCounters();
+    }
+    if (!tracePath.empty() && writeChromeTrace(tracePath)) {
+        std::cout << "Wrote trace to " << tracePath << std::endl;
+    }
 
     // Terminate and destroy GLFW before the function ends
     glfwDestroyWindow(window);
@@ -0,0 +1,245 @@
+// Minimap mesh: greedy merged rectangles in one vertex buffer, patched chunk by chunk
+#include "minimap.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Colour per tile: floor, walls, door, thin wall
+static const float minimapColors[numTileTypes][3] = {
+    {0.0f, 0.0f, 0.0f},
+    {1.0f, 1.0f, 1.0f},
+    {0.8f, 0.3f, 0.3f},
+    {0.3f, 0.4f, 0.8f},
+    {0.6f, 0.45f, 0.2f},
+    {0.6f, 0.6f, 0.6f}
+};
+
+const int floatsPerQuad = 4 * 6; // 4 vertices of position and colour
+
+int minimapTile(int cell, const std::vector<Door>& doorTable)
+{
+    int tile = mapArray[cell];
+    if (tile == tileDoor) {
+        // Open as far as blocksMovement() lets the player through
+        const Door* door = findDoorIn(doorTable, cell);
+        if (door && door->open >= 0.9f)
+            return 0;
+    }
+    return std::clamp(tile, 0, numTileTypes - 1);
+}
+
+// Append the vertices (BL, BR, TL, TR) of the rectangle covering cells x..x+w-1, rows y..y+h-1
+static void appendCellRect(std::vector<float>& vertices, int x, int y, int w, int h, const float* rgb)
+{
+    // Rows count down from the top of the map, as in mapArray
+    float lX = pixelToScreenX(x * sq);
+    float rX = pixelToScreenX((x + w) * sq);
+    float tY = pixelToScreenY((mp - y) * sq);
+    float bY = pixelToScreenY((mp - y - h) * sq);
+    vertices.insert(vertices.end(), {
+        lX, bY, 0.0f, rgb[0], rgb[1], rgb[2],
+        rX, bY, 0.0f, rgb[0], rgb[1], rgb[2],
+        lX, tY, 0.0f, rgb[0], rgb[1], rgb[2],
+        rX, tY, 0.0f, rgb[0], rgb[1], rgb[2]
+    });
+}
+
+// Greedy mesh one chunk: grow each unvisited cell right along its row, then down while
+// whole rows match, so open floor and long walls become a handful of rectangles
+static void meshChunk(const MinimapMesh& mesh, int chunk, std::vector<float>& vertices)
+{
+    int x0 = chunk % mesh.chunksPerSide * minimapChunkSize;
+    int y0 = chunk / mesh.chunksPerSide * minimapChunkSize;
+    int x1 = std::min(x0 + minimapChunkSize, mp);
+    int y1 = std::min(y0 + minimapChunkSize, mp);
+
+    bool visited[minimapChunkSize * minimapChunkSize] = {};
+    auto seen = [&](int x, int y) -> bool& { return visited[(y - y0) * minimapChunkSize + (x - x0)]; };
+    auto tileAt = [&](int x, int y) { return mesh.drawnTiles[y * mp + x]; };
+
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            if (seen(x, y))
+                continue;
+            int tile = tileAt(x, y);
+
+            int w = 1;
+            while (x + w < x1 && !seen(x + w, y) && tileAt(x + w, y) == tile)
+                ++w;
+
+            int h = 1;
+            for (; y + h < y1; ++h)
+            {
+                bool rowMatches = true;
+                for (int i = x; i < x + w && rowMatches; ++i)
+                    rowMatches = !seen(i, y + h) && tileAt(i, y + h) == tile;
+                if (!rowMatches)
+                    break;
+            }
+
+            for (int j = y; j < y + h; ++j)
+                for (int i = x; i < x + w; ++i)
+                    seen(i, j) = true;
+            appendCellRect(vertices, x, y, w, h, minimapColors[tile]);
+        }
+    }
+}
+
+// Mesh every chunk from drawnTiles and lay the chunks out with spare room each
+static void layoutMinimapMesh(MinimapMesh& mesh)
+{
+    mesh.chunksPerSide = (mp + minimapChunkSize - 1) / minimapChunkSize;
+    int chunkCount = mesh.chunksPerSide * mesh.chunksPerSide;
+    mesh.chunks.assign(chunkCount, MinimapChunk());
+    mesh.vertices.clear();
+    mesh.quads = 0;
+
+    std::vector<float> chunkVertices;
+    for (int chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        chunkVertices.clear();
+        meshChunk(mesh, chunk, chunkVertices);
+
+        MinimapChunk& slot = mesh.chunks[chunk];
+        slot.firstQuad = mesh.quads;
+        slot.quads = static_cast<int>(chunkVertices.size() / floatsPerQuad);
+        slot.capacity = slot.quads + minimapChunkSlack;
+        mesh.quads += slot.capacity;
+
+        // Spare quads are degenerate (all corners at the origin), so they draw nothing
+        mesh.vertices.insert(mesh.vertices.end(), chunkVertices.begin(), chunkVertices.end());
+        mesh.vertices.resize(size_t(mesh.quads) * floatsPerQuad, 0.0f);
+    }
+}
+
+void buildMinimapMesh(MinimapMesh& mesh, const std::vector<Door>& doorTable)
+{
+    mesh.drawnTiles.resize(mp * mp);
+    for (int cell = 0; cell < mp * mp; ++cell)
+        mesh.drawnTiles[cell] = static_cast<unsigned char>(std::clamp(mapArray[cell], 0, numTileTypes - 1));
+    for (const Door& door : doorTable)
+        mesh.drawnTiles[door.cell] = static_cast<unsigned char>(minimapTile(door.cell, doorTable));
+    layoutMinimapMesh(mesh);
+}
+
+bool updateMinimapMesh(MinimapMesh& mesh, const std::vector<Door>& doorTable, std::vector<MinimapRange>& ranges)
+{
+    ranges.clear();
+
+    // Only door cells change how they're drawn
+    std::vector<int> dirtyChunks;
+    for (const Door& door : doorTable)
+    {
+        unsigned char tile = static_cast<unsigned char>(minimapTile(door.cell, doorTable));
+        if (tile == mesh.drawnTiles[door.cell])
+            continue;
+        mesh.drawnTiles[door.cell] = tile;
+        int chunkX = door.cell % mp / minimapChunkSize;
+        int chunkY = door.cell / mp / minimapChunkSize;
+        dirtyChunks.push_back(chunkY * mesh.chunksPerSide + chunkX);
+    }
+    if (dirtyChunks.empty())
+        return false;
+    std::sort(dirtyChunks.begin(), dirtyChunks.end());
+    dirtyChunks.erase(std::unique(dirtyChunks.begin(), dirtyChunks.end()), dirtyChunks.end());
+
+    std::vector<float> chunkVertices;
+    for (int chunk : dirtyChunks)
+    {
+        chunkVertices.clear();
+        meshChunk(mesh, chunk, chunkVertices);
+        int quads = static_cast<int>(chunkVertices.size() / floatsPerQuad);
+
+        MinimapChunk& slot = mesh.chunks[chunk];
+        if (quads > slot.capacity) {
+            // Out of spare room: lay every chunk out again and upload the whole buffer
+            layoutMinimapMesh(mesh);
+            ranges.clear();
+            return true;
+        }
+
+        // Overwrite the slot, turning quads the chunk no longer needs degenerate
+        size_t first = size_t(slot.firstQuad) * floatsPerQuad;
+        size_t count = size_t(std::max(quads, slot.quads)) * floatsPerQuad;
+        std::copy(chunkVertices.begin(), chunkVertices.end(), mesh.vertices.begin() + first);
+        std::fill(mesh.vertices.begin() + first + chunkVertices.size(), mesh.vertices.begin() + first + count, 0.0f);
+        slot.quads = quads;
+        ranges.push_back({first, count});
+    }
+    return true;
+}
+
+float minimapMinZoom()
+{
+    return std::min(1.0f, float(minimapViewSize) / (mp * sq));
+}
+
+MinimapView minimapViewAt(float x, float y, float zoom)
+{
+    MinimapView view;
+    view.zoom = std::clamp(zoom, minimapMinZoom(), minimapMaxZoom);
+
+    float mapExtent = float(mp * sq);
+    float halfView = minimapViewSize / 2.0f / view.zoom;
+    if (mapExtent <= 2.0f * halfView) {
+        view.centerX = mapExtent / 2.0f;
+        view.centerY = mapExtent / 2.0f;
+    } else {
+        view.centerX = std::clamp(x, halfView, mapExtent - halfView);
+        view.centerY = std::clamp(y, halfView, mapExtent - halfView);
+    }
+    return view;
+}
+
+void minimapViewTransform(const MinimapView& view, float scale[2], float offset[2])
+{
+    // A world position w is built at 2w/D - 1 for a window D pixels across. The viewport is
+    // minimapViewSize pixels across, however many framebuffer pixels it covers, and w belongs
+    // (w - centre) * zoom pixels from its middle: 2 (w - centre) zoom / minimapViewSize in NDC.
+    const float windowSize[2] = {float(windowWidth), float(windowHeight)};
+    const float center[2] = {view.centerX, view.centerY};
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        float d = windowSize[axis];
+        scale[axis] = d * view.zoom / minimapViewSize;
+        offset[axis] = (d - 2.0f * center[axis]) * view.zoom / minimapViewSize;
+    }
+}
+
+void cullMinimapChunks(const MinimapMesh& mesh, const MinimapView& view, std::vector<MinimapDraw>& draws)
+{
+    draws.clear();
+    if (mesh.chunksPerSide == 0)
+        return;
+
+    // Cells in view, then the chunks holding them. Rows count down from the top of the map.
+    float halfView = minimapViewSize / 2.0f / view.zoom;
+    int chunkSpan = minimapChunkSize * sq;
+    int last = mesh.chunksPerSide - 1;
+    int firstX = std::clamp(int(std::floor((view.centerX - halfView) / chunkSpan)), 0, last);
+    int lastX = std::clamp(int(std::floor((view.centerX + halfView) / chunkSpan)), 0, last);
+    int firstY = std::clamp(int(std::floor((mp * sq - view.centerY - halfView) / chunkSpan)), 0, last);
+    int lastY = std::clamp(int(std::floor((mp * sq - view.centerY + halfView) / chunkSpan)), 0, last);
+
+    // Chunks in a row sit next to each other in the buffer, so a row is one run
+    for (int chunkY = firstY; chunkY <= lastY; ++chunkY)
+    {
+        const MinimapChunk& left = mesh.chunks[chunkY * mesh.chunksPerSide + firstX];
+        const MinimapChunk& right = mesh.chunks[chunkY * mesh.chunksPerSide + lastX];
+        draws.push_back({left.firstQuad, right.firstQuad + right.quads - left.firstQuad});
+    }
+}
+
+std::vector<uint> generateQuadIndices(int quads)
+{
+    std::vector<uint> indices;
+    indices.reserve(size_t(quads) * 6);
+    for (uint quad = 0; quad < uint(quads); ++quad)
+    {
+        uint v = quad * 4;
+        indices.insert(indices.end(), {v + 0, v + 1, v + 2, v + 2, v + 3, v + 1});
+    }
+    return indices;
+}
@@ -0,0 +1,77 @@
+// Minimap mesh: runs of same-looking cells greedily merged into rectangles, one vertex buffer
+// uploaded once and patched chunk by chunk when cells change. A fixed-size viewport follows the
+// player, and only the chunks inside it are drawn, in a single call.
+#pragma once
+
+#include "raycast.h"
+
+#include <cstddef>
+
+const int minimapChunkSize = 64; // Cells per side of the chunks meshed and patched independently
+const int minimapChunkSlack = 4; // Spare quads per chunk so a patch usually fits in place
+const int minimapViewSize = 512; // Minimap viewport side in window pixels; the layout scales it to the framebuffer
+const float minimapMaxZoom = 4.0f; // Viewport pixels per world unit at the closest zoom
+
+// Holds where one chunk's quads live in the vertex buffer
+struct MinimapChunk {
+    int firstQuad; // First quad of the chunk's slot
+    int capacity;  // Quads reserved; unused ones are degenerate
+    int quads;     // Quads in use
+};
+
+// Holds the whole minimap mesh. Every quad is 4 vertices in the projection's vertex format,
+// so the index buffer is a fixed pattern (see generateQuadIndices()).
+struct MinimapMesh {
+    std::vector<float> vertices;
+    std::vector<MinimapChunk> chunks;      // Row by row, chunksPerSide x chunksPerSide
+    int chunksPerSide = 0;
+    int quads = 0;                         // Quads in the buffer, including spare ones
+    std::vector<unsigned char> drawnTiles; // Tile each cell was meshed as
+};
+
+// Holds a range of floats in MinimapMesh::vertices to upload again
+struct MinimapRange {
+    size_t first;
+    size_t count;
+};
+
+// Holds what the minimap viewport shows
+struct MinimapView {
+    float centerX, centerY; // World position at the middle of the viewport
+    float zoom;             // Viewport pixels per world unit
+};
+
+// Holds a run of quads to draw
+struct MinimapDraw {
+    int firstQuad;
+    int quads;
+};
+
+// Tile a cell is drawn as: its map tile, except doors open far enough to walk through
+int minimapTile(int cell, const std::vector<Door>& doorTable);
+
+// Greedy mesh every chunk of the map into mesh
+void buildMinimapMesh(MinimapMesh& mesh, const std::vector<Door>& doorTable);
+
+// Re-mesh the chunks of any door cell that opened or closed since the mesh was built.
+// Returns false when nothing changed. Otherwise ranges holds the vertex floats to upload again,
+// or is empty when a chunk outgrew its slot and the whole buffer was laid out anew.
+bool updateMinimapMesh(MinimapMesh& mesh, const std::vector<Door>& doorTable, std::vector<MinimapRange>& ranges);
+
+// Zoom at which the whole map fits the viewport, the farthest the minimap zooms out
+float minimapMinZoom();
+
+// View centred on (x, y) at zoom, clamped to the zoom limits. The centre is kept far enough
+// from the map's edges that the map fills the viewport, or the whole map is centred when it fits.
+MinimapView minimapViewAt(float x, float y, float zoom);
+
+// Scale and offset (x, y each) that take the window coordinates meshes are built in
+// (pixelToScreenX/Y of world positions) into the NDC of the minimap's own viewport
+void minimapViewTransform(const MinimapView& view, float scale[2], float offset[2]);
+
+// Fill draws with the quads of the chunks overlapping the view, one run per row of chunks.
+// Only the chunks in view are visited, so the cost doesn't grow with the map.
+void cullMinimapChunks(const MinimapMesh& mesh, const MinimapView& view, std::vector<MinimapDraw>& draws);
+
+// Indices for quads quads of 4 vertices each, two triangles per quad
+std::vector<uint> generateQuadIndices(int quads);
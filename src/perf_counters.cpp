@@ -0,0 +1,179 @@
+// Hardware performance counters (cycles, instructions, cache and branch misses) per profiler zone
+#include "perf_counters.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+thread_local bool perfCountersOnThread = false;
+
+// Holds the running totals for one zone
+struct PerfZoneTotals {
+    const char* name;
+    long long calls;
+    uint64_t values[perfCounterCount];
+};
+
+static std::vector<PerfZoneTotals> perfZones;
+static int perfFds[perfCounterCount] = {-1, -1, -1, -1, -1};
+static int perfSlots[perfCounterCount];  // Position of each counter in a group read, -1 if not open
+static int perfOpenCount = 0;
+
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1; // The group starts when its leader is enabled
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // pid 0, cpu -1: this thread, on whichever CPU it runs
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+static uint64_t cacheMissConfig(uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+bool initPerfCounters()
+{
+#ifdef __linux__
+    const struct { uint32_t type; uint64_t config; } events[perfCounterCount] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cacheMissConfig(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cacheMissConfig(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+
+    perfOpenCount = 0;
+    int leader = -1;
+    for (int counter = 0; counter < perfCounterCount; ++counter)
+    {
+        perfSlots[counter] = -1;
+        perfFds[counter] = openCounter(events[counter].type, events[counter].config, leader);
+        if (perfFds[counter] < 0) {
+            std::cout << "Performance counter unavailable: " << perfCounterNames[counter] << std::endl;
+            continue;
+        }
+        if (leader == -1)
+            leader = perfFds[counter];
+        perfSlots[counter] = perfOpenCount++;
+    }
+    if (leader == -1)
+        return false;
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perfCountersOnThread = true;
+    return true;
+#else
+    std::cout << "Performance counters need Linux perf_event_open" << std::endl;
+    return false;
+#endif
+}
+
+void readPerfCounters(PerfCounterValues& values)
+{
+    values.valid = false;
+#ifdef __linux__
+    if (perfOpenCount == 0)
+        return;
+
+    // Group read layout: counter count, then one value per counter in the order they were opened
+    uint64_t buffer[1 + perfCounterCount];
+    int leader = -1;
+    for (int fd : perfFds)
+    {
+        if (fd >= 0) {
+            leader = fd;
+            break;
+        }
+    }
+    if (read(leader, buffer, sizeof(buffer)) < static_cast<ssize_t>((1 + perfOpenCount) * sizeof(uint64_t)))
+        return;
+    for (int counter = 0; counter < perfCounterCount; ++counter)
+        values.values[counter] = perfSlots[counter] >= 0 ? buffer[1 + perfSlots[counter]] : 0;
+    values.valid = true;
+#endif
+}
+
+void addPerfZone(const char* name, const PerfCounterValues& start)
+{
+    PerfCounterValues end;
+    readPerfCounters(end);
+    if (!start.valid || !end.valid)
+        return;
+
+    // Zones are few, so a linear search by name is enough
+    PerfZoneTotals* zone = nullptr;
+    for (PerfZoneTotals& existing : perfZones)
+    {
+        if (existing.name == name || std::strcmp(existing.name, name) == 0) {
+            zone = &existing;
+            break;
+        }
+    }
+    if (!zone) {
+        perfZones.push_back({name, 0, {}});
+        zone = &perfZones.back();
+    }
+
+    ++zone->calls;
+    for (int counter = 0; counter < perfCounterCount; ++counter)
+        zone->values[counter] += end.values[counter] - start.values[counter];
+}
+
+void printPerfReport(long long frames)
+{
+    if (frames <= 0 || perfZones.empty())
+        return;
+
+    std::printf("%-28s %8s", "zone (per frame)", "calls");
+    for (const char* name : perfCounterNames)
+        std::printf(" %14s", name);
+    std::printf(" %6s\n", "IPC");
+    for (const PerfZoneTotals& zone : perfZones)
+    {
+        std::printf("%-28s %8.2f", zone.name, zone.calls / double(frames));
+        for (int counter = 0; counter < perfCounterCount; ++counter)
+        {
+            if (perfSlots[counter] >= 0)
+                std::printf(" %14.0f", zone.values[counter] / double(frames));
+            else
+                std::printf(" %14s", "-");
+        }
+        if (perfSlots[perfCycles] >= 0 && perfSlots[perfInstructions] >= 0 && zone.values[perfCycles] > 0)
+            std::printf(" %6.2f\n", zone.values[perfInstructions] / double(zone.values[perfCycles]));
+        else
+            std::printf(" %6s\n", "-");
+    }
+}
+
+void shutdownPerfCounters()
+{
+#ifdef __linux__
+    for (int& fd : perfFds)
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+#endif
+    perfOpenCount = 0;
+    perfCountersOnThread = false;
+}
@@ -0,0 +1,42 @@
+// Hardware performance counters (cycles, instructions, cache and branch misses) per profiler zone.
+// Uses perf_event_open on Linux; elsewhere the counters are simply unavailable.
+#pragma once
+
+#include <cstdint>
+
+// Counters read together as one group
+enum PerfCounter {
+    perfCycles,
+    perfInstructions,
+    perfL1dMisses,     // L1 data cache read misses
+    perfLlcMisses,     // Last level cache read misses
+    perfBranchMisses,
+    perfCounterCount
+};
+
+const char* const perfCounterNames[perfCounterCount] = {"cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+// Holds one reading of every counter
+struct PerfCounterValues {
+    uint64_t values[perfCounterCount]; // Only meaningful when valid
+    bool valid = false;
+};
+
+// Whether the calling thread opened counters with initPerfCounters()
+extern thread_local bool perfCountersOnThread;
+
+// Open the counters for the calling thread, user space only. Counters the CPU or kernel doesn't
+// offer are skipped. Returns false if none could be opened (not Linux, no PMU, perf_event_paranoid).
+bool initPerfCounters();
+
+// Read every open counter in one syscall
+void readPerfCounters(PerfCounterValues& values);
+
+// Add the counts since start to the totals of the zone called name
+void addPerfZone(const char* name, const PerfCounterValues& start);
+
+// Print per-frame averages of every zone's counts, with IPC, over the given number of frames
+void printPerfReport(long long frames);
+
+// Close the counters
+void shutdownPerfCounters();
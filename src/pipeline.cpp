@@ -0,0 +1,278 @@
+// Frame pipeline: simulation, cast/build and GL submission as separate stages
+#include "pipeline.h"
+#include "lightmap.h"
+#include "profiler.h"
+#include "triple_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+// Holds what the cast needs from one simulation tick
+struct SimSnapshot {
+    Pose previous;              // Player before the tick
+    Pose current;               // Player after the tick
+    Clock::time_point tickTime; // When the tick was due; the camera interpolates from here
+    ViewModes modes;
+    std::vector<Door> doors;    // The cast reads doors from here, never from the live table
+    float simMs = 0.0f;         // Time the tick took
+};
+
+static TripleBuffer<SimSnapshot> snapshots; // Simulation thread -> cast thread
+static TripleBuffer<FramePacket> packets;   // Cast thread -> GL thread
+
+// Buttons held now, and everything held since the last tick
+static std::atomic<unsigned> heldButtons{0};
+static std::atomic<unsigned> latchedButtons{0};
+
+// Resolution asked for by requestResolution(), columns in the high bits and rows in the low 8; 0 when none is waiting
+static std::atomic<unsigned> requestedResolution{0};
+// Projection size asked for by requestProjectionSize(), width in the high 16 bits and height in the low; 0 when none is waiting
+static std::atomic<unsigned> requestedProjectionSize{0};
+
+// Projection path asked for by setProjectionPath()
+static std::atomic<int> projectionPath{projectionMesh};
+
+static bool pipelineThreaded = false;
+static InputLog* pipelineRecording = nullptr;
+static std::thread simulationThread;
+static std::thread castThread;
+
+// Frame requests from the GL thread and the packets answering them. The packets themselves
+// travel through the triple buffer; the mutex only lets the idle side sleep.
+static std::mutex frameMutex;
+static std::condition_variable frameWake;
+static long long framesRequested = 0;
+static long long framesPublished = 0;
+static bool pipelineStop = false;
+
+// Single-threaded stage state
+static FramePacket serialPacket;
+static Clock::time_point lastFrame;
+static double simAccumulator = 0.0;
+
+// Run one tick with the buttons latched since the last one
+static void runTick()
+{
+    unsigned buttons = latchedButtons.exchange(heldButtons.load(std::memory_order_relaxed), std::memory_order_acq_rel);
+    if (pipelineRecording)
+        pipelineRecording->ticks.push_back(static_cast<uint16_t>(buttons));
+    stepSimulation(buttons);
+    queueDoorRebakes();
+}
+
+// Switch numSlices, wallRows and the projection size to requested ones. Only on the thread that casts.
+static void applyRequestedResolution()
+{
+    unsigned size = requestedProjectionSize.exchange(0, std::memory_order_relaxed);
+    if (size != 0) {
+        projectionWidth = static_cast<int>(size >> 16);
+        projectionHeight = static_cast<int>(size & 0xffff);
+    }
+    unsigned resolution = requestedResolution.exchange(0, std::memory_order_relaxed);
+    if (resolution == 0)
+        return;
+    numSlices = static_cast<int>(resolution >> 8);
+    wallRows = static_cast<int>(resolution & 0xff);
+}
+
+// Cast and build the projection for the path asked for
+static void buildPacket(FramePacket& packet, const ViewModes& modes, const std::vector<Door>& doorTable)
+{
+    auto path = static_cast<ProjectionPath>(projectionPath.load(std::memory_order_relaxed));
+    buildFrame(packet.frame, modes, doorTable, path);
+}
+
+static void publishSnapshot(Clock::time_point tickTime, float simMs)
+{
+    SimSnapshot& snapshot = snapshots.writeSlot();
+    snapshot.previous = previousPlayer;
+    snapshot.current = player;
+    snapshot.tickTime = tickTime;
+    snapshot.modes = viewModes;
+    snapshot.doors = doors;
+    snapshot.simMs = simMs;
+    snapshots.publish();
+}
+
+static void simulationWorker()
+{
+    profilerThreadName("simulation");
+    const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(simTickSeconds));
+    Clock::time_point nextTick = Clock::now() + tickDuration;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            if (pipelineStop)
+                return;
+        }
+        std::this_thread::sleep_until(nextTick);
+
+        // After a stall, drop the backlog instead of racing through it
+        Clock::time_point start = Clock::now();
+        if (start - nextTick > maxTicksPerFrame * tickDuration)
+            nextTick = start;
+
+        runTick();
+        publishSnapshot(nextTick, std::chrono::duration<float, std::milli>(Clock::now() - start).count());
+        nextTick += tickDuration;
+    }
+}
+
+static void castWorker()
+{
+    profilerThreadName("cast");
+    while (true)
+    {
+        long long sequence;
+        {
+            std::unique_lock<std::mutex> lock(frameMutex);
+            frameWake.wait(lock, [] { return pipelineStop || framesRequested > framesPublished; });
+            if (pipelineStop)
+                return;
+            sequence = framesRequested;
+        }
+
+        PROFILE_ZONE("cast frame");
+        snapshots.update();
+        const SimSnapshot& snapshot = snapshots.readSlot();
+
+        // Render the camera as far past the latest tick as the clock has moved, so motion is
+        // smooth at any frame rate; the simulation is never more than one tick ahead of it
+        double sinceTick = std::chrono::duration<double>(Clock::now() - snapshot.tickTime).count();
+        float alpha = static_cast<float>(std::clamp(sinceTick / simTickSeconds, 0.0, 1.0));
+        setCamera(interpolatePose(snapshot.previous, snapshot.current, alpha));
+
+        // The cast reads the baked light, so finished rebakes are applied on this thread
+        applyFinishedRebakes();
+        applyRequestedResolution();
+
+        FramePacket& packet = packets.writeSlot();
+        buildPacket(packet, snapshot.modes, snapshot.doors);
+        packet.doors = snapshot.doors;
+        packet.simMs = snapshot.simMs;
+        packet.sequence = sequence;
+        packets.publish();
+
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            framesPublished = sequence;
+        }
+        frameWake.notify_all();
+    }
+}
+
+void startPipeline(bool threaded, InputLog* recording)
+{
+    pipelineThreaded = threaded;
+    pipelineRecording = recording;
+    heldButtons = 0;
+    latchedButtons = 0;
+    requestedResolution = 0;
+    requestedProjectionSize = 0;
+    framesRequested = 0;
+    framesPublished = 0;
+    pipelineStop = false;
+    simAccumulator = 0.0;
+    lastFrame = Clock::time_point();
+
+    if (threaded) {
+        // The cast always has a snapshot to read, even before the first tick
+        publishSnapshot(Clock::now(), 0.0f);
+        simulationThread = std::thread(simulationWorker);
+        castThread = std::thread(castWorker);
+    }
+}
+
+void submitButtons(unsigned buttons)
+{
+    heldButtons.store(buttons, std::memory_order_relaxed);
+    latchedButtons.fetch_or(buttons, std::memory_order_acq_rel);
+}
+
+// Both stages on the calling thread: as many fixed ticks as the elapsed time covers,
+// then the camera interpolated between the last two ticks
+static const FramePacket& buildSerialFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (lastFrame != Clock::time_point())
+        simAccumulator += std::chrono::duration<double>(now - lastFrame).count();
+    lastFrame = now;
+
+    int ticks = 0;
+    while (simAccumulator >= simTickSeconds && ticks < maxTicksPerFrame)
+    {
+        runTick();
+        simAccumulator -= simTickSeconds;
+        ++ticks;
+    }
+    if (ticks == maxTicksPerFrame)
+        simAccumulator = std::min(simAccumulator, simTickSeconds);
+    setCamera(interpolatedPlayer(static_cast<float>(simAccumulator / simTickSeconds)));
+    applyFinishedRebakes();
+    applyRequestedResolution();
+    serialPacket.simMs = std::chrono::duration<float, std::milli>(Clock::now() - now).count();
+
+    buildPacket(serialPacket, viewModes, doors);
+    serialPacket.doors = doors;
+    serialPacket.sequence = ++framesRequested;
+    return serialPacket;
+}
+
+void requestResolution(const RenderResolution& resolution)
+{
+    requestedResolution.store(static_cast<unsigned>(resolution.slices) << 8 | static_cast<unsigned>(resolution.rows),
+                              std::memory_order_relaxed);
+}
+
+void requestProjectionSize(int width, int height)
+{
+    width = std::clamp(width, 1, 0xffff);
+    height = std::clamp(height, 1, 0xffff);
+    requestedProjectionSize.store(static_cast<unsigned>(width) << 16 | static_cast<unsigned>(height), std::memory_order_relaxed);
+}
+
+void setProjectionPath(ProjectionPath path)
+{
+    projectionPath.store(path, std::memory_order_relaxed);
+}
+
+const FramePacket& acquireFrame()
+{
+    if (!pipelineThreaded)
+        return buildSerialFrame();
+
+    PROFILE_ZONE("wait for cast");
+    long long sequence;
+    {
+        std::unique_lock<std::mutex> lock(frameMutex);
+        sequence = ++framesRequested;
+        frameWake.notify_all();
+
+        // The first frame has nothing older to show, so it waits for its own packet
+        long long wanted = std::max(sequence - 1, 1LL);
+        frameWake.wait(lock, [wanted] { return framesPublished >= wanted; });
+    }
+    packets.update();
+    return packets.readSlot();
+}
+
+void stopPipeline()
+{
+    if (!pipelineThreaded)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        pipelineStop = true;
+    }
+    frameWake.notify_all();
+    simulationThread.join();
+    castThread.join();
+    pipelineThreaded = false;
+}
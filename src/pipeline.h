@@ -0,0 +1,44 @@
+// Frame pipeline: simulation, cast/build and GL submission as separate stages.
+// Threaded, the simulation runs fixed ticks on its own thread and publishes snapshots, a cast
+// thread turns the newest snapshot into a frame packet, and the GL thread only uploads and draws.
+// Stages hand off through lock-free triple buffers.
+#pragma once
+
+#include "game.h"
+#include "input_log.h"
+#include "resolution.h"
+
+// Holds one frame ready for the GL thread
+struct FramePacket {
+    FrameOutput frame;        // Cast, ray lines and projection
+    std::vector<Door> doors;  // Doors as the frame was cast, for drawing them on the minimap
+    float simMs = 0.0f;       // Simulation and lightmap time of the tick the frame was cast from
+    long long sequence = 0;   // Frame request the packet answers
+};
+
+// Start the stages after initGame(). Threaded, the simulation and cast get a thread each;
+// otherwise both run on the calling thread inside acquireFrame(). When recording is given,
+// every tick's buttons are appended to it, so it must outlive the pipeline.
+void startPipeline(bool threaded, InputLog* recording);
+
+// Buttons currently held, sampled once per frame by the GL thread. A press shorter than a
+// tick is latched until the next tick so it isn't lost.
+void submitButtons(unsigned buttons);
+
+// Resolution for frames cast from now on. The cast stage applies it between frames,
+// so a frame never mixes two resolutions.
+void requestResolution(const RenderResolution& resolution);
+
+// Projection size in pixels for frames cast from now on, applied between frames like the resolution
+void requestProjectionSize(int width, int height);
+
+// How frames cast from now on are projected, where their view supports it (see buildFrame())
+void setProjectionPath(ProjectionPath path);
+
+// Ask for the next frame and return the previous one, waiting for it if the cast is behind.
+// Threaded, the cast of the next frame overlaps drawing this one, so the GL thread sees at
+// most one frame of latency. The packet stays valid until the next call.
+const FramePacket& acquireFrame();
+
+// Stop and join the stage threads
+void stopPipeline();
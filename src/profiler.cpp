@@ -0,0 +1,124 @@
+// Scoped timing zones recorded into per-thread ring buffers, exported as Chrome trace JSON
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> profilerEnabled{false};
+
+// Holds one finished zone
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Holds one thread's ring of zones. Only the owning thread writes; head is published
+// with release ordering so the exporter sees complete events.
+struct ThreadTrace {
+    int id;
+    std::string name;
+    std::vector<ProfileEvent> events; // Allocated on the first recorded zone, so naming a thread is cheap
+    std::atomic<uint64_t> head{0}; // Total events ever recorded
+};
+
+// Every thread that has recorded a zone or been named. Traces are kept after their thread exits
+// so its zones still make it into the export. The mutex is only taken on a thread's first zone.
+static std::mutex tracesMutex;
+static std::vector<std::unique_ptr<ThreadTrace>> traces;
+static thread_local ThreadTrace* threadTrace = nullptr;
+
+static const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+
+static ThreadTrace& currentTrace()
+{
+    if (threadTrace == nullptr) {
+        std::lock_guard<std::mutex> lock(tracesMutex);
+        traces.push_back(std::make_unique<ThreadTrace>());
+        threadTrace = traces.back().get();
+        threadTrace->id = static_cast<int>(traces.size());
+        threadTrace->name = "thread " + std::to_string(threadTrace->id);
+    }
+    return *threadTrace;
+}
+
+uint64_t profilerNow()
+{
+    // Offset by one so a valid timestamp is never 0, which ProfileZone uses for "not recording"
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerEpoch).count() + 1;
+}
+
+void profilerRecord(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadTrace& trace = currentTrace();
+    // The exporter only reads events below head, so the ring can be sized here, before the first
+    // event is published
+    if (trace.events.empty())
+        trace.events.resize(profilerRingSize);
+    uint64_t head = trace.head.load(std::memory_order_relaxed);
+    trace.events[head % profilerRingSize] = {name, start, end};
+    trace.head.store(head + 1, std::memory_order_release);
+}
+
+void profilerThreadName(const std::string& name)
+{
+    ThreadTrace& trace = currentTrace();
+    std::lock_guard<std::mutex> lock(tracesMutex);
+    trace.name = name;
+}
+
+// Write a zone name as a JSON string. Names are literals from the code, so only quotes and backslashes need escaping.
+static void writeJsonString(FILE* file, const std::string& text)
+{
+    std::fputc('"', file);
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            std::fputc('\\', file);
+        std::fputc(c, file);
+    }
+    std::fputc('"', file);
+}
+
+bool writeChromeTrace(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cout << "Could not write trace " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(tracesMutex);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const std::unique_ptr<ThreadTrace>& trace : traces)
+    {
+        std::fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+                     first ? "" : ",\n", trace->id);
+        writeJsonString(file, trace->name);
+        std::fprintf(file, "}}");
+        first = false;
+
+        uint64_t head = trace->head.load(std::memory_order_acquire);
+        uint64_t begin = head > static_cast<uint64_t>(profilerRingSize) ? head - profilerRingSize : 0;
+        for (uint64_t i = begin; i < head; ++i)
+        {
+            const ProfileEvent& event = trace->events[i % profilerRingSize];
+            // Chrome trace timestamps are in microseconds
+            std::fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                         trace->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            writeJsonString(file, event.name);
+            std::fputc('}', file);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
@@ -0,0 +1,64 @@
+// Scoped timing zones recorded into per-thread ring buffers, exported as Chrome trace JSON.
+// Load the output in chrome://tracing or https://ui.perfetto.dev.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "perf_counters.h"
+
+// Whether zones are being recorded. While false a zone costs one relaxed load and a branch.
+extern std::atomic<bool> profilerEnabled;
+
+// Events kept per thread; the oldest are overwritten once a thread records more
+const int profilerRingSize = 1 << 16;
+
+// Nanoseconds since the profiler's epoch
+uint64_t profilerNow();
+
+// Record a finished zone on the calling thread. name must outlive the profiler (a string literal).
+void profilerRecord(const char* name, uint64_t start, uint64_t end);
+
+// Name the calling thread in exported traces
+void profilerThreadName(const std::string& name);
+
+// Write every thread's recorded zones as Chrome trace-event JSON. Returns false if the file can't be written.
+// Zones still being written by other threads may be missed, so call this while workers are idle.
+bool writeChromeTrace(const std::string& path);
+
+// Times the enclosing scope when the profiler is enabled, and counts its
+// hardware events too on a thread that opened performance counters
+struct ProfileZone {
+    const char* name;
+    uint64_t start = 0;
+    PerfCounterValues counters;
+
+    explicit ProfileZone(const char* zoneName) : name(zoneName)
+    {
+        if (profilerEnabled.load(std::memory_order_relaxed)) {
+            start = profilerNow();
+            if (perfCountersOnThread)
+                readPerfCounters(counters);
+        }
+    }
+    ~ProfileZone()
+    {
+        if (start != 0) {
+            if (counters.valid)
+                addPerfZone(name, counters);
+            profilerRecord(name, start, profilerNow());
+        }
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Time the rest of the enclosing scope as a zone called name.
+// Building with RAYCAST_NO_PROFILER compiles zones out entirely.
+#ifdef RAYCAST_NO_PROFILER
+#define PROFILE_ZONE(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
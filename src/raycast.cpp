@@ -0,0 +1,715 @@
+// Raycasting core: map, doors, shading tables, casting and projection mesh building
+#include "raycast.h"
+#include "lightmap.h"
+#include "collision.h"
+
+#include <algorithm>
+
+int mp = 8;
+
+// Map layout (1=wall, 2/3=special, 4=door, 5=thin wall, 0=empty)
+std::vector<int> mapArray = {
+    1,1,1,1,1,1,1,1,
+    1,0,0,2,0,0,0,1,
+    1,4,2,2,0,0,0,1,
+    1,0,0,0,0,0,0,1,
+    1,0,0,0,0,3,0,1,
+    1,0,5,0,0,3,0,1,
+    1,0,0,0,0,0,0,1,
+    1,1,1,1,1,1,1,1
+};
+
+std::vector<Door> doors;
+
+float palette[paletteRamps * rampShades][3];
+unsigned char colormap[lightLevels][paletteRamps * rampShades];
+unsigned char wallTextures[numTileTypes][texSize * texSize];
+std::vector<unsigned char> tileLight;
+unsigned char backgroundIndex = 0;
+
+// Camera
+float playerX = 256;
+float playerY = 256;
+float rotation = M_PI/2 + 0.01; // Camera rotation in radians
+
+// Player state
+float speed = 0.5;       // Player movement speed per tick
+float rotationSpeed = 0.03; // Player rotation speed per tick
+int playerSize = 10;     // Player square size (for minimap)
+int numSlices = 128;     // Number of rays for raycasting/projection
+int wallRows = texSize;  // Rows drawn per projection column
+float fieldOfView = defaultFieldOfView;
+int projectionWidth = referenceProjectionSize;
+int projectionHeight = referenceProjectionSize;
+float viewPlaneHalfWidth = 1.0f;
+
+// Replace the map with a size x size grid of tiles and rebuild the tables derived from it
+void loadMap(int size, const std::vector<int>& tiles)
+{
+    mp = size;
+    mapArray = tiles;
+    initDoors();
+    initTileLight();
+}
+
+// Build the door side table from the door and thin wall tiles in mapArray.
+// A door flanked by solid tiles left and right spans X, anything else spans Y.
+void initDoors()
+{
+    doors.clear();
+    for (int cell = 0; cell < mp * mp; ++cell)
+    {
+        int tile = mapArray[cell];
+        if (tile != tileDoor && tile != tileThin)
+            continue;
+
+        int grid_x = cell % mp;
+        bool solidLeft = grid_x > 0 && mapArray[cell - 1] != 0;
+        bool solidRight = grid_x < mp - 1 && mapArray[cell + 1] != 0;
+
+        Door door;
+        door.cell = cell;
+        door.alongY = !(solidLeft && solidRight);
+        door.open = 0.0f;
+        door.target = 0.0f;
+        doors.push_back(door);
+    }
+}
+
+// Find the door occupying a map cell in a door table, or nullptr if there is none
+const Door* findDoorIn(const std::vector<Door>& table, int cell)
+{
+    auto it = std::lower_bound(table.begin(), table.end(), cell,
+                               [](const Door& door, int c) { return door.cell < c; });
+    if (it == table.end() || it->cell != cell)
+        return nullptr;
+    return &*it;
+}
+
+// Find the door occupying a map cell, or nullptr if there is none
+Door* findDoor(int cell)
+{
+    return const_cast<Door*>(findDoorIn(doors, cell));
+}
+
+// Test a ray against the mid-cell plane of a door. Only called once a grid walk has
+// entered a door cell, so rays through ordinary cells never pay for it.
+// (rx, ry) is where the ray entered the cell and is moved to the hit point on success.
+bool hitDoor(const Door& door, float& rx, float& ry, float tanth, float atanth)
+{
+    float cellL = (door.cell % mp) * sq;
+    float cellB = (mp - 1 - door.cell / mp) * sq;
+
+    float hx, hy, along;
+    if (door.alongY) {
+        hx = cellL + sq / 2.0f;
+        hy = ry + (hx - rx) * tanth;
+        along = (hy - cellB) / sq;
+    } else {
+        hy = cellB + sq / 2.0f;
+        hx = rx + (hy - ry) * atanth;
+        along = (hx - cellL) / sq;
+    }
+
+    // The door slides towards the low edge of the cell, leaving [0, open) passable
+    if (along < door.open || along > 1.0f)
+        return false;
+
+    rx = hx;
+    ry = hy;
+    return true;
+}
+
+// Advance every door towards its target open amount
+void updateDoors()
+{
+    for (Door& door : doors)
+    {
+        if (door.open < door.target)
+            door.open = std::min(door.open + doorSpeed, door.target);
+        else if (door.open > door.target)
+            door.open = std::max(door.open - doorSpeed, door.target);
+    }
+}
+
+// True if a body may not stand in the given map cell
+bool blocksMovement(int cell, const std::vector<Door>& doorTable)
+{
+    int tile = mapArray[cell];
+    if (tile == tileDoor) {
+        const Door* door = findDoorIn(doorTable, cell);
+        return door == nullptr || door->open < 0.9f;
+    }
+    return tile != 0;
+}
+
+// Walk the grid cells crossed by the segment (x0, y0) -> (x1, y1) and report whether
+// it reaches the end unblocked. Doors count as open past half way; ignoreCell is skipped
+// so a segment may end on a door plane. doorTable lets callers on other threads pass a snapshot.
+bool gridLineOfSight(float x0, float y0, float x1, float y1, int ignoreCell, const std::vector<Door>& doorTable)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    int col = int(std::floor(x0 / sq)), row = int(std::floor(y0 / sq));
+    int endCol = int(std::floor(x1 / sq)), endRow = int(std::floor(y1 / sq));
+    int stepCol = dx > 0 ? 1 : -1, stepRow = dy > 0 ? 1 : -1;
+
+    // Segment parameter at the next column/row boundary and per whole cell
+    float tDeltaX = dx != 0 ? std::fabs(sq / dx) : INFINITY;
+    float tDeltaY = dy != 0 ? std::fabs(sq / dy) : INFINITY;
+    float tMaxX = dx != 0 ? ((dx > 0 ? (col + 1) * sq : col * sq) - x0) / dx : INFINITY;
+    float tMaxY = dy != 0 ? ((dy > 0 ? (row + 1) * sq : row * sq) - y0) / dy : INFINITY;
+
+    while (true)
+    {
+        if (col < 0 || col >= mp || row < 0 || row >= mp)
+            return false;
+
+        int cell = (mp - 1 - row) * mp + col;
+        int tile = mapArray[cell];
+        if (tile != 0 && cell != ignoreCell) {
+            if (tile != tileDoor)
+                return false;
+            const Door* door = findDoorIn(doorTable, cell);
+            if (door == nullptr || door->open < 0.5f)
+                return false;
+        }
+
+        if (col == endCol && row == endRow)
+            return true;
+
+        if (tMaxX < tMaxY) {
+            if (tMaxX > 1.0f) return true;
+            tMaxX += tDeltaX;
+            col += stepCol;
+        } else {
+            if (tMaxY > 1.0f) return true;
+            tMaxY += tDeltaY;
+            row += stepRow;
+        }
+    }
+}
+
+// Build the palette, colormap, wall textures and per-tile light levels
+void initShading()
+{
+    // Base colour of each ramp; ramp n is used by tile type n
+    const float rampColors[paletteRamps][3] = {
+        {0.5f, 0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}, {0.8f, 0.3f, 0.2f}, {0.3f, 0.4f, 0.9f},
+        {0.6f, 0.4f, 0.2f}, {0.4f, 0.8f, 0.4f}, {0.9f, 0.9f, 0.5f}, {0.5f, 0.9f, 0.9f},
+        {0.9f, 0.5f, 0.9f}, {0.7f, 0.7f, 0.7f}, {0.3f, 0.3f, 0.3f}, {0.9f, 0.6f, 0.3f},
+        {0.2f, 0.6f, 0.3f}, {0.6f, 0.2f, 0.5f}, {0.3f, 0.3f, 0.6f}, {0.6f, 0.6f, 0.3f}
+    };
+
+    for (int ramp = 0; ramp < paletteRamps; ++ramp)
+    {
+        for (int shade = 0; shade < rampShades; ++shade)
+        {
+            float intensity = (shade + 1.0f) / rampShades;
+            for (int c = 0; c < 3; ++c)
+                palette[ramp * rampShades + shade][c] = rampColors[ramp][c] * intensity;
+        }
+    }
+
+    // Darkening a colour only moves it down its own ramp, so no nearest-colour search is needed
+    for (int level = 0; level < lightLevels; ++level)
+    {
+        float scale = static_cast<float>(level) / (lightLevels - 1);
+        for (int index = 0; index < paletteRamps * rampShades; ++index)
+        {
+            int ramp = index / rampShades;
+            int shade = static_cast<int>(std::lround((index % rampShades) * scale));
+            colormap[level][index] = static_cast<unsigned char>(ramp * rampShades + shade);
+        }
+    }
+
+    // Brick pattern: bright bricks with darker mortar rows and staggered joints
+    for (int type = 0; type < numTileTypes; ++type)
+    {
+        for (int ty = 0; ty < texSize; ++ty)
+        {
+            for (int tx = 0; tx < texSize; ++tx)
+            {
+                int stagger = (ty / 4) % 2 == 0 ? 0 : texSize / 2;
+                bool mortar = ty % 4 == 3 || (tx + stagger) % texSize == 0;
+                int shade = mortar ? 9 : 15 - (tx * 7 + ty * 3) % 3;
+                wallTextures[type][ty * texSize + tx] = static_cast<unsigned char>(type * rampShades + shade);
+            }
+        }
+    }
+
+    // The window clears to 0.3 grey; indexed frames fill the space around walls with the closest colour
+    const float background[3] = {0.3f, 0.3f, 0.3f};
+    float closest = INFINITY;
+    for (int index = 0; index < paletteRamps * rampShades; ++index)
+    {
+        float distance = 0.0f;
+        for (int c = 0; c < 3; ++c)
+            distance += (palette[index][c] - background[c]) * (palette[index][c] - background[c]);
+        if (distance < closest) {
+            closest = distance;
+            backgroundIndex = static_cast<unsigned char>(index);
+        }
+    }
+
+    initTileLight();
+}
+
+// Set the ambient light of every map cell
+void initTileLight()
+{
+    // Ambient light is half brightness, the pillar sits in deeper shadow; point lights add to this
+    tileLight.resize(mp * mp);
+    for (int cell = 0; cell < mp * mp; ++cell)
+        tileLight[cell] = mapArray[cell] == 3 ? lightLevels / 4 : lightLevels / 2;
+}
+
+// Light level for a wall hit, combining the tile's ambient light, the baked
+// light on the face that was hit, distance fog and face side.
+// Hits without a map cell (map edge, sector walls) are lit at full brightness.
+int wallLightLevel(const RayInfo& ray)
+{
+    int level = lightLevels - 1;
+    if (ray.mapCell >= 0)
+        level = tileLight[ray.mapCell] + bakedFaceLight(ray.mapCell, ray.face, ray.wallX);
+    level -= static_cast<int>(ray.distance * fogScale);
+    if (ray.hitEW) level -= sideShade;
+    return std::clamp(level, 0, lightLevels - 1);
+}
+
+// Convert pixel X coordinate to normalized device coordinate (OpenGL)
+float pixelToScreenX(int x)
+{
+    return 2.0f * static_cast<float>(x) / windowWidth - 1.0f;
+}
+
+// Convert pixel Y coordinate to normalized device coordinate (OpenGL)
+float pixelToScreenY(int y)
+{
+    return 2.0f * static_cast<float>(y) / windowHeight - 1.0f;
+}
+
+// The same for a pixel of the projection, in the projection's viewport
+float projectionToScreenX(int x)
+{
+    return 2.0f * static_cast<float>(x) / projectionWidth - 1.0f;
+}
+
+float projectionToScreenY(int y)
+{
+    return 2.0f * static_cast<float>(y) / projectionHeight - 1.0f;
+}
+
+// Append a rectangle (BL, BR, TL, TR) and its two triangles to a mesh without temporary vectors
+void appendRect(VerticesIndices& mesh, float lX, float rX, float bY, float tY, const float* rgb)
+{
+    uint vertOffset = mesh.vertices.size() / 6; // 6 floats per vertex
+    mesh.vertices.insert(mesh.vertices.end(), {
+        lX, bY, 0.0f, rgb[0], rgb[1], rgb[2],
+        rX, bY, 0.0f, rgb[0], rgb[1], rgb[2],
+        lX, tY, 0.0f, rgb[0], rgb[1], rgb[2],
+        rX, tY, 0.0f, rgb[0], rgb[1], rgb[2]
+    });
+    mesh.indices.insert(mesh.indices.end(), {
+        vertOffset + 0, vertOffset + 1, vertOffset + 2,
+        vertOffset + 2, vertOffset + 3, vertOffset + 1
+    });
+}
+
+// Generate rectangle vertices and colors in order: BL, BR, TL, TR (each with color)
+std::vector<float> generateRect(float lX, float rX, float bY, float tY, std::vector<float> color)
+{
+    std::vector<float> mapVertices;
+
+    // Bottom left vertex
+    mapVertices.push_back(lX);
+    mapVertices.push_back(bY);
+    mapVertices.push_back(0.0f);
+
+    // Color
+    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
+
+    // Bottom right vertex
+    mapVertices.push_back(rX);
+    mapVertices.push_back(bY);
+    mapVertices.push_back(0.0f);
+
+    // Color
+    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
+
+    // Top left vertex
+    mapVertices.push_back(lX);
+    mapVertices.push_back(tY);
+    mapVertices.push_back(0.0f);
+
+    // Color
+    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
+
+    // Top right vertex
+    mapVertices.push_back(rX);
+    mapVertices.push_back(tY);
+    mapVertices.push_back(0.0f);
+
+    // Color
+    mapVertices.insert(mapVertices.end(), color.begin(), color.end());
+
+    return mapVertices;
+}
+
+// Holds how one column's wall is drawn: its span in window rows and the texel column and shades it samples
+struct WallColumn {
+    float startY;                 // Bottom of the wall
+    float height;
+    const unsigned char* texture; // Palette indices of the hit tile's texture
+    const unsigned char* shades;  // Colormap row for the hit's light level
+    int tx;                       // Texture column
+};
+
+static WallColumn wallColumn(const RayInfo& ray)
+{
+    WallColumn column;
+    float dist = ray.distance;
+    bool sideV = !ray.hitEW; // True if vertical wall, False if horizontal
+    int map_type = std::clamp(ray.mapHit, 0, numTileTypes - 1);
+    float rot = ray.angle;
+    column.texture = wallTextures[map_type];
+    column.shades = colormap[wallLightLevel(ray)];
+
+    float height_scalar = 0.5f;
+    // The camera plane spans the projection's width, so that sets the scale in both directions
+    column.height = 64.0f * projectionWidth / (dist * viewPlaneHalfWidth) * height_scalar;
+    column.startY = projectionHeight / 2.0f - column.height / 2.0f;
+
+    int tx = std::clamp(int(ray.wallX * texSize), 0, texSize - 1);
+    if (sideV) {
+        // Vertical wall: flip so textures read left to right from either side
+        if (rot < M_PI)
+            tx = texSize - 1 - tx;
+    } else {
+        // Horizontal wall: flip so textures read left to right from either side
+        if (rot > M_PI / 2.0f && rot < 3 * M_PI / 2.0f)
+            tx = texSize - 1 - tx;
+    }
+    column.tx = tx;
+    return column;
+}
+
+// Generate the 3D projection rectangles and indices for the right side of the window
+VerticesIndices generateProjectionInfo(const std::vector<RayInfo>& rayHitInfo)
+{
+    VerticesIndices projectionInfo;
+    if (rayHitInfo.empty())
+        return projectionInfo;
+
+    int columns = static_cast<int>(rayHitInfo.size());
+    float ivar = float(projectionWidth) / columns;
+    projectionInfo.vertices.reserve(size_t(columns) * wallRows * 24);
+    projectionInfo.indices.reserve(size_t(columns) * wallRows * 6);
+
+    for (int i = 0; i < columns; ++i)
+    {
+        WallColumn wall = wallColumn(rayHitInfo[i]);
+        float start_x = i * ivar;
+        float start_y = wall.startY;
+        float y_slice = wall.height / wallRows;
+
+        for (int row = 0; row < wallRows; ++row)
+        {
+            float rect_top = start_y + row * y_slice;
+            float rect_bottom = rect_top + y_slice + 1.0f;
+
+            // At reduced resolution each row takes the texel at its centre
+            int ty = (2 * row + 1) * texSize / (2 * wallRows);
+
+            // One colormap lookup shades the texel for distance, tile light and side
+            const float* rgb = palette[wall.shades[wall.texture[ty * texSize + wall.tx]]];
+
+            // Rectangle vertices (BL, BR, TL, TR)
+            float lX = projectionToScreenX((int)start_x);
+            float rX = projectionToScreenX((int)(start_x + ivar));
+            float bY = projectionToScreenY((int)rect_bottom);
+            float tY = projectionToScreenY((int)rect_top);
+
+            appendRect(projectionInfo, lX, rX, bY, tY, rgb);
+        }
+    }
+    return projectionInfo;
+}
+
+void renderIndexedProjection(const std::vector<RayInfo>& rayHitInfo, IndexedFramebuffer& framebuffer)
+{
+    framebuffer.columns = static_cast<int>(rayHitInfo.size());
+    framebuffer.rows = projectionHeight;
+    framebuffer.pixels.resize(size_t(framebuffer.columns) * framebuffer.rows);
+
+    for (int i = 0; i < framebuffer.columns; ++i)
+    {
+        WallColumn wall = wallColumn(rayHitInfo[i]);
+        unsigned char* column = &framebuffer.pixels[size_t(i) * framebuffer.rows];
+
+        // Rows whose centres fall inside the wall; the rest show the background
+        int first = std::clamp(int(std::ceil(wall.startY - 0.5f)), 0, framebuffer.rows);
+        int last = std::clamp(int(std::ceil(wall.startY + wall.height - 0.5f)), first, framebuffer.rows);
+        std::fill(column, column + first, backgroundIndex);
+        std::fill(column + last, column + framebuffer.rows, backgroundIndex);
+
+        // Each pixel takes the texel at the centre of its wall row, as the mesh's rectangles do
+        float rowsPerPixel = wallRows / wall.height;
+        for (int y = first; y < last; ++y)
+        {
+            int row = std::min(int((y + 0.5f - wall.startY) * rowsPerPixel), wallRows - 1);
+            int ty = (2 * row + 1) * texSize / (2 * wallRows);
+            column[y] = wall.shades[wall.texture[ty * texSize + wall.tx]];
+        }
+    }
+}
+
+std::vector<float> generatePlayerVertices()
+{
+    float halfWidth = (float)playerSize / windowWidth;
+    float halfHeight = (float)playerSize / windowHeight;
+
+    std::vector<float> color = {1.0f, 0.5f, 0.5f};
+
+    float lX = -halfWidth, rX = halfWidth;
+    float bY = -halfHeight, tY = halfHeight;
+
+    return generateRect(lX, rX, bY, tY, color);
+}
+
+void setFieldOfView(float degrees)
+{
+    fieldOfView = std::clamp(degrees, minFieldOfView, maxFieldOfView);
+    viewPlaneHalfWidth = std::tan(fieldOfView * float(M_PI) / 360.0f);
+}
+
+// Per-column camera plane positions and ray angles, for tableColumns columns at tableFieldOfView
+static int tableColumns = 0;
+static float tableFieldOfView = 0.0f;
+static std::vector<float> columnPlane, columnAngle;
+
+void updateColumnTables()
+{
+    if (tableColumns == numSlices && tableFieldOfView == fieldOfView)
+        return;
+    tableColumns = numSlices;
+    tableFieldOfView = fieldOfView;
+    columnPlane.resize(numSlices);
+    columnAngle.resize(numSlices);
+    // Columns run left to right across the projection, so the offset falls as the column rises.
+    // Each ray goes through its column's centre.
+    for (int column = 0; column < numSlices; ++column)
+    {
+        columnPlane[column] = viewPlaneHalfWidth * (1.0f - (2.0f * column + 1.0f) / numSlices);
+        columnAngle[column] = std::atan(columnPlane[column]);
+    }
+}
+
+float rayPlaneOffset(int column)
+{
+    return columnPlane[column];
+}
+
+float rayAngleOffset(int column)
+{
+    return columnAngle[column];
+}
+
+// Inverse of rayPlaneOffset(): the point is on the plane at left / forward
+float columnForViewPoint(float forward, float left)
+{
+    return (1.0f - left / (forward * viewPlaneHalfWidth)) * numSlices / 2.0f - 0.5f;
+}
+
+RayLinesResult generateRayLinesAndDistances(const std::vector<Door>& doorTable) {
+    RayLinesResult result;
+    result.hitInfo.resize(numSlices);
+    result.lineVertices.reserve(size_t(numSlices) * 12);
+    updateColumnTables();
+
+    // Each ray is the camera direction plus its column's offset along the camera plane, so the
+    // only trig per frame is the camera's own. Its forward component is 1, which makes the
+    // distance along the camera direction the fisheye-free distance.
+    float dirX = std::cos(rotation), dirY = std::sin(rotation);
+    float pz = 0.0f;
+
+    for (int column = 0; column < numSlices; ++column) {
+        RayInfo& hitInfo = result.hitInfo[column];
+        float plane = rayPlaneOffset(column);
+        float rayX = dirX - dirY * plane;
+        float rayY = dirY + dirX * plane;
+        if (rayX == 0.0f) rayX = 1e-7f;
+        if (rayY == 0.0f) rayY = 1e-7f;
+        hitInfo.angle = rotation + rayAngleOffset(column);
+        float tanth = rayY / rayX;
+        float atanth = rayX / rayY;
+
+        // --- Vertical grid intersections ---
+        float rx = playerX, ry = playerY;
+        float dx, dy;
+        if (rayX > 0.0f) {
+            rx = std::ceil(playerX / sq) * sq + 0.0001f;
+            dx = sq;
+        } else {
+            rx = std::floor(playerX / sq) * sq - 0.0001f;
+            dx = -sq;
+        }
+        ry = playerY + (rx - playerX) * tanth;
+        dy = dx * tanth;
+        if (ry > mp * sq) { ry = mp * sq; rx = playerX + (ry - playerY) * atanth; }
+        else if (ry < 0) { ry = 0; rx = playerX + (ry - playerY) * atanth; }
+        float vrx = rx, vry = ry;
+        int vHit = 1, vCell = -1;
+        const Door* vDoor = nullptr;
+        while (true) {
+            int grid_x = int(vrx / sq);
+            int grid_y = int(mp - vry / sq);
+            if (grid_x < 0 || grid_x >= mp || grid_y < 0 || grid_y >= mp)
+                break;
+            int tile = mapArray[grid_y * mp + grid_x];
+            if (tile == tileDoor || tile == tileThin) {
+                const Door* door = findDoorIn(doorTable, grid_y * mp + grid_x);
+                if (door && hitDoor(*door, vrx, vry, tanth, atanth)) {
+                    vHit = tile;
+                    vCell = door->cell;
+                    vDoor = door;
+                    break;
+                }
+            } else if (tile != 0) {
+                vHit = tile;
+                vCell = grid_y * mp + grid_x;
+                break;
+            }
+            vrx += dx;
+            vry += dy;
+            ++result.castSteps;
+        }
+        std::pair<float, float> v_rayloc = {vrx, vry};
+
+        // --- Horizontal grid intersections ---
+        rx = playerX; ry = playerY;
+        if (rayY > 0.0f) {
+            ry = std::ceil(playerY / sq) * sq + 0.0001f;
+            dy = sq;
+        } else {
+            ry = std::floor(playerY / sq) * sq - 0.0001f;
+            dy = -sq;
+        }
+        rx = playerX + (ry - playerY) * atanth;
+        dx = dy * atanth;
+        if (rx > mp * sq) { rx = mp * sq; ry = playerY + (rx - playerX) * tanth; }
+        else if (rx < 0) { rx = 0; ry = playerY + (rx - playerX) * tanth; }
+        float hrx = rx, hry = ry;
+        int hHit = 1, hCell = -1;
+        const Door* hDoor = nullptr;
+        while (true) {
+            int grid_x = int(hrx / sq);
+            int grid_y = int(mp - hry / sq);
+            if (grid_x < 0 || grid_x >= mp || grid_y < 0 || grid_y >= mp)
+                break;
+            int tile = mapArray[grid_y * mp + grid_x];
+            if (tile == tileDoor || tile == tileThin) {
+                const Door* door = findDoorIn(doorTable, grid_y * mp + grid_x);
+                if (door && hitDoor(*door, hrx, hry, tanth, atanth)) {
+                    hHit = tile;
+                    hCell = door->cell;
+                    hDoor = door;
+                    break;
+                }
+            } else if (tile != 0) {
+                hHit = tile;
+                hCell = grid_y * mp + grid_x;
+                break;
+            }
+            hrx += dx;
+            hry += dy;
+            ++result.castSteps;
+        }
+        std::pair<float, float> h_rayloc = {hrx, hry};
+
+        // --- Find shortest ray ---
+        float hx = h_rayloc.first, hy = h_rayloc.second;
+        float h_dist = (hx - playerX) * dirX + (hy - playerY) * dirY;
+
+        float vx = v_rayloc.first, vy = v_rayloc.second;
+        float v_dist = (vx - playerX) * dirX + (vy - playerY) * dirY;
+
+        float rx_final, ry_final;
+        const Door* hitDoorInfo;
+        if (h_dist < v_dist) {
+            rx_final = hx;
+            ry_final = hy;
+            hitInfo.distance = h_dist;
+            hitInfo.mapHit = hHit;
+            hitInfo.mapCell = hCell;
+            hitInfo.hitEW = hDoor ? !hDoor->alongY : true;
+            hitDoorInfo = hDoor;
+        } else {
+            rx_final = vx;
+            ry_final = vy;
+            hitInfo.distance = v_dist;
+            hitInfo.mapHit = vHit;
+            hitInfo.mapCell = vCell;
+            hitInfo.hitEW = vDoor ? !vDoor->alongY : false;
+            hitDoorInfo = vDoor;
+        }
+
+        // Face of the hit cell the ray landed on, used to look up baked lighting
+        if (hitInfo.hitEW)
+            hitInfo.face = rayY > 0.0f ? 2 : 3;
+        else
+            hitInfo.face = rayX > 0.0f ? 0 : 1;
+
+        // Position along the face for texturing; door textures slide with the door
+        float along = hitInfo.hitEW ? rx_final : ry_final;
+        hitInfo.wallX = along / sq - std::floor(along / sq);
+        if (hitDoorInfo)
+            hitInfo.wallX = std::max(hitInfo.wallX - hitDoorInfo->open, 0.0f);
+
+        // Convert to OpenGL screen space
+        float glStartX = pixelToScreenX((int)playerX);
+        float glStartY = pixelToScreenY((int)playerY);
+        float glEndX = pixelToScreenX((int)rx_final);
+        float glEndY = pixelToScreenY((int)ry_final);
+
+        // Line: player -> hit
+        result.lineVertices.insert(result.lineVertices.end(), {
+            glStartX, glStartY, pz, 1.0f, 1.0f, 1.0f,
+            glEndX,   glEndY,   pz, 1.0f, 1.0f, 1.0f
+        });
+    }
+    return result;
+}
+
+// Walk and strafe as one move, sliding along walls (see collision.h)
+void movePlayer(Pose& player, float signfb, float signlr) {
+    float dx = speed * (cos(player.rotation) * signfb + cos(player.rotation + M_PI/2) * signlr);
+    float dy = speed * (sin(player.rotation) * signfb + sin(player.rotation + M_PI/2) * signlr);
+    moveCircle(player.x, player.y, dx, dy, playerRadius);
+}
+
+// Open or close the door directly in front of the player
+void useDoorAhead(const Pose& player) {
+    int grid_x = int((player.x + 0.75f * sq * cos(player.rotation)) / sq);
+    int grid_y = int(mp - (player.y + 0.75f * sq * sin(player.rotation)) / sq);
+    if (grid_x < 0 || grid_x >= mp || grid_y < 0 || grid_y >= mp)
+        return;
+
+    Door* door = findDoor(grid_y * mp + grid_x);
+    if (door == nullptr || mapArray[door->cell] != tileDoor)
+        return;
+
+    // Don't shut a door on the player
+    int player_cell = int(mp - player.y / sq) * mp + int(player.x / sq);
+    if (door->target > 0.5f && door->cell == player_cell)
+        return;
+    door->target = door->target > 0.5f ? 0.0f : 1.0f;
+}
+
+void turnPlayer(Pose& player, float dir) {
+    player.rotation += rotationSpeed * dir;
+    if (player.rotation < 0) {
+        player.rotation += 2 * M_PI;
+    } else if (player.rotation > 2 * M_PI) {
+        player.rotation -= 2 * M_PI;
+    }
+}
@@ -0,0 +1,165 @@
+// Raycasting core shared by the renderer and the lightmap baker
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <sys/types.h>
+
+// Window and map configuration
+const int windowWidth = 1024;
+const int windowHeight = 512;
+const int sq = 64; // Width and height of each square in the grid
+extern int mp;     // Number of columns and rows in the map
+
+// Map layout (1=wall, 2/3=special, 4=door, 5=thin wall, 0=empty), mp * mp tiles
+extern std::vector<int> mapArray;
+
+// Tile types whose geometry sits mid-cell and is resolved through the door table
+const int tileDoor = 4; // Sliding door
+const int tileThin = 5; // Thin wall (a door that never opens)
+
+// Holds the state of one door or thin wall
+struct Door {
+    int cell;     // Index into mapArray
+    bool alongY;  // True if the door plane runs along Y (x = cell centre), false if along X
+    float open;   // 0 = closed, 1 = fully slid into the frame
+    float target; // Open amount the door is animating towards
+};
+
+// Door side table, sorted by cell so lookups are a binary search
+extern std::vector<Door> doors;
+const float doorSpeed = 0.02f; // Open amount change per frame
+
+// Palette and colormap configuration (Doom COLORMAP style)
+// The palette is 16 ramps of 16 shades; palette index = ramp * 16 + shade, shade 15 brightest.
+const int paletteRamps = 16;
+const int rampShades = 16;
+const int lightLevels = 32;     // Rows in the colormap, lightLevels - 1 is full brightness
+const int texSize = 16;         // Wall textures are texSize x texSize palette indices
+const int numTileTypes = 6;     // Tile values 0..5 each get a wall texture
+const float fogScale = 1.0f / 48.0f; // Light levels lost per unit of distance
+const int sideShade = 6;        // Light levels lost on horizontal (EW) faces
+
+extern float palette[paletteRamps * rampShades][3];                    // RGB per palette index
+extern unsigned char colormap[lightLevels][paletteRamps * rampShades]; // Light level x palette index -> palette index
+extern unsigned char wallTextures[numTileTypes][texSize * texSize];    // Palette indices per texel
+extern std::vector<unsigned char> tileLight;                           // Ambient light level of each map cell
+extern unsigned char backgroundIndex;                                  // Palette index nearest the window's clear colour
+
+// Holds a position and facing, for the simulated player or the camera
+struct Pose {
+    float x;
+    float y;
+    float rotation; // Radians
+};
+
+// Camera the cast and projection render from. The simulation advances its own player
+// pose in fixed ticks and the camera is interpolated from it each frame (see game.h).
+extern float playerX;
+extern float playerY;
+extern float rotation;      // Camera rotation in radians
+
+// Player state
+extern float speed;         // Player movement speed per simulation tick
+extern float rotationSpeed; // Player rotation speed per simulation tick
+extern int playerSize;      // Player square size (for minimap)
+extern int numSlices;       // Number of rays for raycasting/projection
+extern int wallRows;        // Rows drawn per projection column; texSize draws every texel, fewer merge them
+
+// Size in pixels of the projection the cast builds for. Wall heights, the projection mesh and the
+// indexed framebuffer follow it. Only the thread that casts changes it (see requestProjectionSize()).
+const int referenceProjectionSize = 512; // Projection width and height at the default window size
+extern int projectionWidth;
+extern int projectionHeight;
+
+// Holds both vertex and index data for OpenGL rendering
+struct VerticesIndices
+{
+    std::vector<float> vertices; // Interleaved vertex attributes (position, color)
+    std::vector<uint> indices;   // Indices for indexed drawing
+};
+
+// Holds the projection as 8-bit palette indices, a quarter of the bytes of RGBA.
+// Column-major, rows counting up from the bottom, so each column's span is written contiguously.
+struct IndexedFramebuffer {
+    int columns = 0;
+    int rows = 0;
+    std::vector<unsigned char> pixels; // pixels[column * rows + row]
+};
+
+// Holds information about a single raycast hit
+struct RayInfo{
+    float distance; // Distance to the wall hit
+    float angle;    // Angle of the ray
+    int mapHit;     // Map info of the wall hit
+    int mapCell;    // Index into mapArray of the wall hit, -1 if the ray left the map
+    int face;       // Face of the hit cell: 0=west, 1=east, 2=south, 3=north
+    float wallX;    // Hit position along the wall face, 0..1
+    bool hitEW;     // True if ray hit east/west wall, false if north/south
+};
+
+// Holds both the line vertices for ray visualization and hit info for projection
+struct RayLinesResult {
+    std::vector<float> lineVertices; // For OpenGL line drawing
+    std::vector<RayInfo> hitInfo;    // Hit info for projection
+    long long castSteps = 0;         // Grid lines (or sector walls) visited by all rays, for steps-per-ray stats
+};
+
+// Map
+void loadMap(int size, const std::vector<int>& tiles);
+
+// Doors
+void initDoors();
+const Door* findDoorIn(const std::vector<Door>& table, int cell);
+Door* findDoor(int cell);
+bool hitDoor(const Door& door, float& rx, float& ry, float tanth, float atanth);
+void updateDoors();
+// True if a body may not stand in the cell; doors are read from doorTable
+bool blocksMovement(int cell, const std::vector<Door>& doorTable = doors);
+
+// Grid line of sight, used for shadow tests
+bool gridLineOfSight(float x0, float y0, float x1, float y1, int ignoreCell, const std::vector<Door>& doorTable);
+
+// Shading
+void initShading();
+void initTileLight();
+int wallLightLevel(const RayInfo& ray);
+
+// Coordinate conversion and mesh building. The minimap, ray lines and overlay are built in window
+// coordinates of the default windowWidth x windowHeight layout; the projection in its own pixels.
+// Each is drawn in its own viewport, which places it in the real window.
+float pixelToScreenX(int x);
+float pixelToScreenY(int y);
+float projectionToScreenX(int x);
+float projectionToScreenY(int y);
+void appendRect(VerticesIndices& mesh, float lX, float rX, float bY, float tY, const float* rgb);
+std::vector<float> generateRect(float lX, float rX, float bY, float tY, std::vector<float> color);
+VerticesIndices generateProjectionInfo(const std::vector<RayInfo>& rayHitInfo);
+// Draw the same walls into framebuffer, one column per hit and projectionHeight rows, over backgroundIndex
+void renderIndexedProjection(const std::vector<RayInfo>& rayHitInfo, IndexedFramebuffer& framebuffer);
+std::vector<float> generatePlayerVertices();
+
+// Casting. Column rays pass through evenly spaced points on a flat camera plane, so columns are
+// evenly spaced on screen and fieldOfView is the true horizontal view. Walls are scaled to match,
+// so at 90 degrees the square projection keeps them in proportion.
+const float defaultFieldOfView = 90.0f;
+const float minFieldOfView = 30.0f;
+const float maxFieldOfView = 150.0f;
+extern float fieldOfView;        // Degrees across the projection; set with setFieldOfView()
+extern float viewPlaneHalfWidth; // tan(fieldOfView / 2), the camera plane's half width at distance 1
+// Set the field of view, clamped to minFieldOfView..maxFieldOfView, before casting starts
+void setFieldOfView(float degrees);
+// Rebuild the per-column tables if numSlices or fieldOfView changed since the last call.
+// Every cast calls this first, on the thread that casts, so the lookups below never rebuild.
+void updateColumnTables();
+float rayPlaneOffset(int column); // Camera plane position of a column's ray, left positive
+float rayAngleOffset(int column); // Angle of a column's ray from the camera rotation, left positive
+// The fractional column whose ray passes through a view-space point forward and left of the camera
+float columnForViewPoint(float forward, float left);
+// Doors are read from doorTable, so a cast on another thread can use a snapshot of them
+RayLinesResult generateRayLinesAndDistances(const std::vector<Door>& doorTable = doors);
+
+// Player control, one simulation tick at a time
+void movePlayer(Pose& player, float signfb, float signlr);
+void useDoorAhead(const Pose& player);
+void turnPlayer(Pose& player, float dir);
@@ -0,0 +1,74 @@
+// Dynamic resolution: trades column count and rows per column against a frame-time budget
+#include "resolution.h"
+#include "raycast.h"
+
+#include <algorithm>
+
+// Weight of the newest frame in the smoothed costs
+const float resolutionSmoothing = 0.1f;
+
+// Time the frame takes given the cost of its two halves
+static float frameCost(const ResolutionController& controller, float castMs, float renderMs)
+{
+    return controller.pipelined ? std::max(castMs, renderMs) : castMs + renderMs;
+}
+
+static void stepResolution(ResolutionController& controller, int step)
+{
+    controller.level += step;
+    controller.slowFrames = 0;
+    controller.fastFrames = 0;
+    controller.settleFrames = resolutionSettleFrames;
+}
+
+bool updateResolution(ResolutionController& controller, float castMs, float renderMs)
+{
+    // Right after a step the frames in flight still show the old resolution, so the
+    // smoothed costs are only restarted from the latest frame
+    if (controller.settleFrames > 0) {
+        --controller.settleFrames;
+        controller.castMs = castMs;
+        controller.renderMs = renderMs;
+        return false;
+    }
+    controller.castMs += (castMs - controller.castMs) * resolutionSmoothing;
+    controller.renderMs += (renderMs - controller.renderMs) * resolutionSmoothing;
+    float cost = frameCost(controller, controller.castMs, controller.renderMs);
+
+    if (cost > controller.budgetMs * resolutionDownFraction && controller.level > 0) {
+        controller.fastFrames = 0;
+        if (++controller.slowFrames >= resolutionDownFrames) {
+            stepResolution(controller, -1);
+            return true;
+        }
+        return false;
+    }
+    controller.slowFrames = 0;
+
+    if (controller.level + 1 >= resolutionLevelCount)
+        return false;
+
+    // Both halves are assumed to scale with the columns times the rows drawn, which
+    // overestimates the cast (it only scales with columns) and so errs towards staying put
+    const RenderResolution& current = resolutionLevels[controller.level];
+    const RenderResolution& next = resolutionLevels[controller.level + 1];
+    float scale = float(next.slices * next.rows) / float(current.slices * current.rows);
+    float predicted = frameCost(controller, controller.castMs * scale, controller.renderMs * scale);
+    if (predicted < controller.budgetMs * resolutionUpFraction) {
+        if (++controller.fastFrames >= resolutionUpFrames) {
+            stepResolution(controller, 1);
+            return true;
+        }
+    } else {
+        controller.fastFrames = 0;
+    }
+    return false;
+}
+
+RenderResolution resolutionForWidth(int level, int projectionWidth)
+{
+    RenderResolution resolution = resolutionLevels[level];
+    int slices = resolution.slices * projectionWidth / referenceProjectionSize;
+    resolution.slices = std::clamp(slices & ~1, 2, std::max(2, projectionWidth & ~1));
+    return resolution;
+}
@@ -0,0 +1,46 @@
+// Dynamic resolution: trades column count and rows per column against a frame-time budget
+#pragma once
+
+// Holds a resolution the cast and projection can render at
+struct RenderResolution {
+    int slices; // Columns cast and projected (numSlices), even
+    int rows;   // Rows drawn per column (wallRows), dividing texSize
+};
+
+// Resolutions from cheapest to most detailed, for a projection referenceProjectionSize pixels
+// wide. The controller moves one step at a time.
+const RenderResolution resolutionLevels[] = {
+    {32, 4}, {48, 4}, {64, 8}, {96, 8}, {128, 16}, {160, 16}, {192, 16}, {256, 16}
+};
+const int resolutionLevelCount = sizeof(resolutionLevels) / sizeof(resolutionLevels[0]);
+const int defaultResolutionLevel = 4; // 128 columns, every texel: the fixed resolution
+
+const float resolutionDownFraction = 0.9f; // Step down when the cost passes this share of the budget
+const float resolutionUpFraction = 0.7f;   // Step up when the next level's predicted cost stays under this
+const int resolutionDownFrames = 8;        // Slow frames in a row before stepping down
+const int resolutionUpFrames = 90;         // Fast frames in a row before stepping up
+const int resolutionSettleFrames = 15;     // Frames ignored after a step while the new costs come in
+
+// Holds the controller's state. Costs are smoothed so one slow frame doesn't change the
+// resolution, and the thresholds for stepping up and down are far enough apart that the
+// cost after a step lands between them instead of bouncing back.
+struct ResolutionController {
+    float budgetMs = 1000.0f / 60.0f; // Frame time to keep under
+    bool pipelined = false;           // Cast and render overlap, so the slower one sets the frame time
+    int level = defaultResolutionLevel;
+    float castMs = 0.0f;              // Smoothed cast and projection building time
+    float renderMs = 0.0f;            // Smoothed upload, draw and GPU time
+    int slowFrames = 0;               // Consecutive frames over the step down threshold
+    int fastFrames = 0;               // Consecutive frames whose step up prediction fits
+    int settleFrames = resolutionSettleFrames; // Frames to wait after a step (or at start) before measuring again
+};
+
+// Add one frame's measured costs: castMs for casting and building the projection, renderMs for
+// uploading and drawing it (the larger of CPU submission and GPU time). Returns true when the
+// controller moved to another level; the caller then applies resolutionLevels[controller.level].
+bool updateResolution(ResolutionController& controller, float castMs, float renderMs);
+
+// A level's resolution for a projection projectionWidth pixels wide. Columns scale with the
+// width so each covers the same share of pixels at any window size, kept even and at most one
+// per pixel; rows per column stay as they are.
+RenderResolution resolutionForWidth(int level, int projectionWidth);
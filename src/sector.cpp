@@ -0,0 +1,291 @@
+// Sector/portal world for walls at any angle (Build engine style), casting into the same per-column records as the grid
+#include "sector.h"
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+std::vector<SectorVertex> sectorVertices;
+std::vector<SectorWall> sectorWalls;
+std::vector<Sector> sectors;
+
+// Sector the player was last found in; the search for the next frame starts here
+static int playerSector = -1;
+
+// Upper bound on portal windows walked per frame, so malformed worlds can't loop forever
+const int maxPortalWindows = 1024;
+
+// Nearest forward distance a wall is clipped to before projecting
+const float sectorNearPlane = 0.5f;
+
+// Add a sector from counter-clockwise corners; portals[i]/tiles[i] describe the edge leaving corner i
+static void addSector(const std::vector<SectorVertex>& corners, const std::vector<int>& portals, const std::vector<int>& tiles)
+{
+    Sector sector;
+    sector.firstWall = static_cast<int>(sectorWalls.size());
+    sector.numWalls = static_cast<int>(corners.size());
+    for (size_t i = 0; i < corners.size(); ++i)
+    {
+        SectorWall wall;
+        wall.vertex = static_cast<int>(sectorVertices.size());
+        wall.portal = portals[i];
+        wall.tile = tiles[i];
+        sectorVertices.push_back(corners[i]);
+        sectorWalls.push_back(wall);
+    }
+    sectors.push_back(sector);
+}
+
+void initSectorWorld()
+{
+    sectorVertices.clear();
+    sectorWalls.clear();
+    sectors.clear();
+
+    // 0: hexagonal hall around the start, open to the south room and the north-east wing
+    addSector({{176, 176}, {336, 176}, {400, 256}, {336, 336}, {176, 336}, {112, 256}},
+              {1, -1, 2, -1, -1, -1},
+              {0, 1, 0, 2, 1, 3});
+    // 1: south room with splayed side walls
+    addSector({{176, 176}, {130, 60}, {380, 60}, {336, 176}},
+              {-1, -1, -1, 0},
+              {1, 2, 1, 0});
+    // 2: north-east wing
+    addSector({{400, 256}, {470, 330}, {420, 470}, {336, 336}},
+              {-1, -1, -1, 0},
+              {3, 1, 2, 0});
+
+    playerSector = findSector(playerX, playerY, -1);
+}
+
+// End vertex of a wall: the start of the next wall in its sector
+static const SectorVertex& wallEnd(const Sector& sector, int wallIndex)
+{
+    int next = wallIndex + 1 == sector.firstWall + sector.numWalls ? sector.firstWall : wallIndex + 1;
+    return sectorVertices[sectorWalls[next].vertex];
+}
+
+static bool insideSector(int index, float x, float y)
+{
+    const Sector& sector = sectors[index];
+    for (int w = sector.firstWall; w < sector.firstWall + sector.numWalls; ++w)
+    {
+        const SectorVertex& a = sectorVertices[sectorWalls[w].vertex];
+        const SectorVertex& b = wallEnd(sector, w);
+        if ((b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x) < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+int findSector(float x, float y, int hint)
+{
+    if (hint >= 0 && hint < static_cast<int>(sectors.size())) {
+        if (insideSector(hint, x, y))
+            return hint;
+        const Sector& sector = sectors[hint];
+        for (int w = sector.firstWall; w < sector.firstWall + sector.numWalls; ++w)
+        {
+            int portal = sectorWalls[w].portal;
+            if (portal >= 0 && insideSector(portal, x, y))
+                return portal;
+        }
+    }
+    for (int i = 0; i < static_cast<int>(sectors.size()); ++i)
+    {
+        if (insideSector(i, x, y))
+            return i;
+    }
+    return -1;
+}
+
+// Push a circle out of every solid wall it overlaps. Walls are few and each is one segment, so
+// all of them are checked; two passes settle a circle wedged into a corner between two walls.
+static void pushOutOfSectorWalls(float& x, float& y, float radius)
+{
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (const Sector& sector : sectors)
+        {
+            for (int w = sector.firstWall; w < sector.firstWall + sector.numWalls; ++w)
+            {
+                if (sectorWalls[w].portal >= 0)
+                    continue;
+                const SectorVertex& a = sectorVertices[sectorWalls[w].vertex];
+                const SectorVertex& b = wallEnd(sector, w);
+                float edgeX = b.x - a.x, edgeY = b.y - a.y;
+                float length2 = edgeX * edgeX + edgeY * edgeY;
+                if (length2 <= 0.0f)
+                    continue;
+                float t = std::clamp(((x - a.x) * edgeX + (y - a.y) * edgeY) / length2, 0.0f, 1.0f);
+                float awayX = x - (a.x + edgeX * t), awayY = y - (a.y + edgeY * t);
+                float distance = std::sqrt(awayX * awayX + awayY * awayY);
+                if (distance >= radius)
+                    continue;
+                if (distance > 0.0f) {
+                    x += awayX / distance * (radius - distance);
+                    y += awayY / distance * (radius - distance);
+                } else {
+                    // On the wall itself: back out to the interior, on the wall's left
+                    float length = std::sqrt(length2);
+                    x -= edgeY / length * radius;
+                    y += edgeX / length * radius;
+                }
+            }
+        }
+    }
+}
+
+void movePlayerInSectors(Pose& player, float signfb, float signlr)
+{
+    float dx = speed * (cos(player.rotation) * signfb + cos(player.rotation + M_PI/2) * signlr);
+    float dy = speed * (sin(player.rotation) * signfb + sin(player.rotation + M_PI/2) * signlr);
+
+    // Steps no longer than half the radius, as moveCircle() takes, so no wall is stepped over.
+    // A step that still ends outside every sector, through a gap where walls meet, is undone.
+    int steps = std::max(1, int(std::ceil(std::sqrt(dx * dx + dy * dy) / (playerRadius * 0.5f))));
+    for (int i = 0; i < steps; ++i)
+    {
+        float x = player.x + dx / steps, y = player.y + dy / steps;
+        pushOutOfSectorWalls(x, y, playerRadius);
+        if (findSector(x, y, playerSector) < 0)
+            return;
+        player.x = x;
+        player.y = y;
+    }
+}
+
+// Holds a sector to draw and the range of projection columns it is visible through
+struct PortalWindow {
+    int sector;
+    int left, right; // Inclusive column range
+    int from;        // Sector the window was entered from, -1 for the player's sector
+};
+
+RayLinesResult castSectors()
+{
+    RayLinesResult result;
+    result.hitInfo.resize(numSlices);
+    std::vector<bool> filled(numSlices, false);
+    updateColumnTables();
+
+    float cosR = std::cos(rotation), sinR = std::sin(rotation);
+    float pz = 0.0f;
+
+    // Columns the world doesn't cover come out as a distant plain wall
+    for (int column = 0; column < numSlices; ++column)
+    {
+        RayInfo& hit = result.hitInfo[column];
+        hit.distance = 1e4f;
+        hit.angle = rotation + rayAngleOffset(column);
+        hit.mapHit = 1;
+        hit.mapCell = -1;
+        hit.face = 0;
+        hit.wallX = 0.0f;
+        hit.hitEW = false;
+    }
+
+    playerSector = findSector(playerX, playerY, playerSector);
+    std::deque<PortalWindow> windows;
+    if (playerSector >= 0)
+        windows.push_back({playerSector, 0, numSlices - 1, -1});
+
+    int walked = 0;
+    while (!windows.empty() && walked++ < maxPortalWindows)
+    {
+        PortalWindow window = windows.front();
+        windows.pop_front();
+        const Sector& sector = sectors[window.sector];
+        result.castSteps += sector.numWalls;
+
+        for (int w = sector.firstWall; w < sector.firstWall + sector.numWalls; ++w)
+        {
+            const SectorWall& wall = sectorWalls[w];
+            if (wall.portal >= 0 && wall.portal == window.from)
+                continue;
+
+            const SectorVertex& a = sectorVertices[wall.vertex];
+            const SectorVertex& b = wallEnd(sector, w);
+
+            // Walls only face the viewer from the sector's interior side
+            float ex = b.x - a.x, ey = b.y - a.y;
+            if (ex * (playerY - a.y) - ey * (playerX - a.x) <= 0.0f)
+                continue;
+
+            // View space: f forward along the player's rotation, s to the left
+            float fa = (a.x - playerX) * cosR + (a.y - playerY) * sinR;
+            float sa = -(a.x - playerX) * sinR + (a.y - playerY) * cosR;
+            float fb = (b.x - playerX) * cosR + (b.y - playerY) * sinR;
+            float sb = -(b.x - playerX) * sinR + (b.y - playerY) * cosR;
+            if (fa < sectorNearPlane && fb < sectorNearPlane)
+                continue;
+            if (fa < sectorNearPlane) {
+                float t = (sectorNearPlane - fa) / (fb - fa);
+                sa += (sb - sa) * t;
+                fa = sectorNearPlane;
+            } else if (fb < sectorNearPlane) {
+                float t = (sectorNearPlane - fb) / (fa - fb);
+                sb += (sa - sb) * t;
+                fb = sectorNearPlane;
+            }
+
+            // Project the edge to columns and clip it to the window it is seen through
+            float colA = columnForViewPoint(fa, sa);
+            float colB = columnForViewPoint(fb, sb);
+            int left = std::max(window.left, int(std::ceil(std::min(colA, colB))));
+            int right = std::min(window.right, int(std::floor(std::max(colA, colB))));
+            if (left > right)
+                continue;
+
+            if (wall.portal >= 0) {
+                windows.push_back({wall.portal, left, right, window.sector});
+                continue;
+            }
+
+            // Solid wall: intersect each uncovered column's ray with the edge. Rays are one unit
+            // forward per unit along them, so t is already the fisheye-free distance.
+            float length = std::sqrt(ex * ex + ey * ey);
+            for (int column = left; column <= right; ++column)
+            {
+                if (filled[column])
+                    continue;
+
+                float plane = rayPlaneOffset(column);
+                float dx = cosR - sinR * plane, dy = sinR + cosR * plane;
+                float denom = dx * ey - dy * ex;
+                if (denom == 0.0f)
+                    continue;
+                float t = ((a.x - playerX) * ey - (a.y - playerY) * ex) / denom;
+                float u = ((a.x - playerX) * dy - (a.y - playerY) * dx) / denom;
+                if (t <= 0.0f)
+                    continue;
+                u = std::clamp(u, 0.0f, 1.0f);
+
+                RayInfo& hit = result.hitInfo[column];
+                hit.distance = t;
+                hit.mapHit = wall.tile;
+                hit.wallX = u * length / sq - std::floor(u * length / sq);
+                hit.hitEW = std::fabs(ex) > std::fabs(ey); // Mostly horizontal edges shade like EW faces
+                filled[column] = true;
+            }
+        }
+    }
+
+    // Ray lines for the minimap, player -> hit
+    float glStartX = pixelToScreenX((int)playerX);
+    float glStartY = pixelToScreenY((int)playerY);
+    for (int column = 0; column < numSlices; ++column)
+    {
+        const RayInfo& hit = result.hitInfo[column];
+        float plane = rayPlaneOffset(column);
+        float length = std::min(hit.distance, 2.0f * windowWidth);
+        float glEndX = pixelToScreenX((int)(playerX + (cosR - sinR * plane) * length));
+        float glEndY = pixelToScreenY((int)(playerY + (sinR + cosR * plane) * length));
+        result.lineVertices.insert(result.lineVertices.end(), {
+            glStartX, glStartY, pz, 1.0f, 1.0f, 1.0f,
+            glEndX,   glEndY,   pz, 1.0f, 1.0f, 1.0f
+        });
+    }
+    return result;
+}
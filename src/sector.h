@@ -0,0 +1,40 @@
+// Sector/portal world for walls at any angle (Build engine style), casting into the same per-column records as the grid
+#pragma once
+
+#include "raycast.h"
+
+// Holds one corner of a sector outline
+struct SectorVertex {
+    float x, y;
+};
+
+// Holds one edge of a sector, running from its vertex to the next wall's vertex
+struct SectorWall {
+    int vertex; // Index into sectorVertices where the edge starts
+    int portal; // Sector on the other side of the edge, -1 for a solid wall
+    int tile;   // Tile type used to texture a solid wall
+};
+
+// Holds one convex sector; its walls run counter-clockwise so the interior is on their left
+struct Sector {
+    int firstWall; // Index into sectorWalls
+    int numWalls;
+};
+
+extern std::vector<SectorVertex> sectorVertices;
+extern std::vector<SectorWall> sectorWalls;
+extern std::vector<Sector> sectors;
+
+// Build the demo sector world around the player's start
+void initSectorWorld();
+
+// Sector containing a point, searching from a hint sector and its neighbours first; -1 if outside the world
+int findSector(float x, float y, int hint);
+
+// Move the player one tick as movePlayer() does, but against the sector world: the player's
+// circle slides along solid walls and passes through portals. The grid isn't consulted.
+void movePlayerInSectors(Pose& player, float signfb, float signlr);
+
+// Cast every projection column through the sector world, front to back through visible portals.
+// Produces the same line vertices and per-column hit records as generateRayLinesAndDistances().
+RayLinesResult castSectors();
@@ -0,0 +1,271 @@
+// Shader programs from files, with cached uniform locations, a binary cache and hot reload
+#include "shader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Source files are read from here; the build points it at the source tree so edits reload
+#ifndef RAYCAST_SHADER_DIR
+#define RAYCAST_SHADER_DIR "shaders"
+#endif
+
+// Linked program binaries are kept here between runs
+#ifndef RAYCAST_SHADER_CACHE_DIR
+#define RAYCAST_SHADER_CACHE_DIR "shader_cache"
+#endif
+
+// Programs reloadChangedShaders() watches
+static std::vector<ShaderProgram*> loadedPrograms;
+
+static std::filesystem::path shaderPath(const std::string& file)
+{
+    return std::filesystem::path(RAYCAST_SHADER_DIR) / file;
+}
+
+static bool readShaderFile(const std::string& file, std::string& source, std::filesystem::file_time_type& time)
+{
+    std::filesystem::path path = shaderPath(file);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "Failed to open shader " << path.string() << std::endl;
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    source = text.str();
+    std::error_code error;
+    time = std::filesystem::last_write_time(path, error);
+    return true;
+}
+
+// Insert defines after the #version line. A #line directive keeps log line numbers matching the file.
+static std::string withDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty())
+        return source;
+    size_t versionEnd = source.find('\n');
+    if (versionEnd == std::string::npos)
+        return source;
+    return source.substr(0, versionEnd + 1) + defines + "#line 2\n" + source.substr(versionEnd + 1);
+}
+
+static GLuint compileShader(GLenum type, const std::string& file, const std::string& source)
+{
+    const char* text = source.c_str();
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+        std::cout << "Shader " << file << " failed to compile:\n" << log.c_str() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static bool linked(GLuint program)
+{
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+// FNV-1a, to tell whether a cached binary was built from the same sources on the same driver
+static uint64_t hashText(uint64_t hash, const char* text)
+{
+    for (; *text; ++text)
+        hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+    return hash;
+}
+
+static uint64_t programKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashText(hash, vertexSource.c_str());
+    hash = hashText(hash, fragmentSource.c_str());
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        hash = hashText(hash, reinterpret_cast<const char*>(glGetString(name)));
+    return hash;
+}
+
+// Program binaries need GL 4.1 or ARB_get_program_binary, and a driver that offers a format
+static bool programBinariesSupported()
+{
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+static std::filesystem::path cachePath(const ShaderProgram& program)
+{
+    std::string name = program.vertexFile + "+" + program.fragmentFile + ".bin";
+    std::replace(name.begin(), name.end(), '/', '_');
+    return std::filesystem::path(RAYCAST_SHADER_CACHE_DIR) / name;
+}
+
+// Cache file layout: key (8 bytes), binary format (4 bytes), then the driver's binary
+static GLuint loadCachedProgram(const ShaderProgram& program, uint64_t key)
+{
+    std::ifstream in(cachePath(program), std::ios::binary);
+    uint64_t cachedKey = 0;
+    uint32_t format = 0;
+    if (!in.read(reinterpret_cast<char*>(&cachedKey), sizeof(cachedKey)) || cachedKey != key ||
+        !in.read(reinterpret_cast<char*>(&format), sizeof(format)))
+        return 0;
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (binary.empty())
+        return 0;
+
+    // Drivers may reject a binary after an update even with the same version string
+    GLuint id = glCreateProgram();
+    glProgramBinary(id, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    if (!linked(id)) {
+        glDeleteProgram(id);
+        return 0;
+    }
+    return id;
+}
+
+static void saveCachedProgram(const ShaderProgram& program, GLuint id, uint64_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(id, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(RAYCAST_SHADER_CACHE_DIR, error);
+    std::ofstream out(cachePath(program), std::ios::binary | std::ios::trunc);
+    uint32_t format32 = format;
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    out.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+    out.write(binary.data(), binary.size());
+}
+
+// Build program's files into a new program object: from the cache if it matches, otherwise
+// compiled, linked and cached. Returns 0 after printing why on failure.
+static GLuint buildProgram(ShaderProgram& program)
+{
+    std::string vertexSource, fragmentSource;
+    if (!readShaderFile(program.vertexFile, vertexSource, program.vertexTime) ||
+        !readShaderFile(program.fragmentFile, fragmentSource, program.fragmentTime))
+        return 0;
+    vertexSource = withDefines(vertexSource, program.defines);
+    fragmentSource = withDefines(fragmentSource, program.defines);
+
+    bool cacheable = programBinariesSupported();
+    uint64_t key = cacheable ? programKey(vertexSource, fragmentSource) : 0;
+    if (cacheable) {
+        GLuint cached = loadCachedProgram(program, key);
+        if (cached)
+            return cached;
+    }
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, program.vertexFile, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, program.fragmentFile, fragmentSource);
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+    GLuint id = glCreateProgram();
+    glAttachShader(id, vertexShader);
+    glAttachShader(id, fragmentShader);
+    if (cacheable)
+        glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(id);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!linked(id)) {
+        GLint length = 0;
+        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        glGetProgramInfoLog(id, length, nullptr, &log[0]);
+        std::cout << "Shaders " << program.vertexFile << " and " << program.fragmentFile
+                  << " failed to link:\n" << log.c_str() << std::endl;
+        glDeleteProgram(id);
+        return 0;
+    }
+    if (cacheable)
+        saveCachedProgram(program, id, key);
+    return id;
+}
+
+// Swap in a newly built program, look its uniforms up and let the owner set the lasting ones
+static void installProgram(ShaderProgram& program, GLuint id)
+{
+    if (program.id)
+        glDeleteProgram(program.id);
+    program.id = id;
+    program.uniforms.clear();
+    for (const std::string& name : program.uniformNames)
+        program.uniforms.push_back(glGetUniformLocation(id, name.c_str()));
+    if (program.onLink) {
+        glUseProgram(id);
+        program.onLink(program);
+    }
+}
+
+bool loadShaderProgram(ShaderProgram& program, const char* vertexFile, const char* fragmentFile,
+                       const std::vector<std::string>& uniformNames, const std::string& defines,
+                       void (*onLink)(const ShaderProgram& program))
+{
+    program.vertexFile = vertexFile;
+    program.fragmentFile = fragmentFile;
+    program.defines = defines;
+    program.uniformNames = uniformNames;
+    program.onLink = onLink;
+    GLuint id = buildProgram(program);
+    if (!id)
+        return false;
+    installProgram(program, id);
+    if (std::find(loadedPrograms.begin(), loadedPrograms.end(), &program) == loadedPrograms.end())
+        loadedPrograms.push_back(&program);
+    return true;
+}
+
+bool reloadChangedShaders()
+{
+    bool reloaded = false;
+    for (ShaderProgram* program : loadedPrograms)
+    {
+        std::error_code error;
+        auto vertexTime = std::filesystem::last_write_time(shaderPath(program->vertexFile), error);
+        auto fragmentTime = std::filesystem::last_write_time(shaderPath(program->fragmentFile), error);
+        if (error || (vertexTime == program->vertexTime && fragmentTime == program->fragmentTime))
+            continue;
+
+        // Only try each edit once, whether it builds or not
+        GLuint id = buildProgram(*program);
+        program->vertexTime = vertexTime;
+        program->fragmentTime = fragmentTime;
+        if (!id)
+            continue;
+        installProgram(*program, id);
+        std::cout << "Reloaded " << program->vertexFile << " and " << program->fragmentFile << std::endl;
+        reloaded = true;
+    }
+    return reloaded;
+}
+
+void deleteShaderProgram(ShaderProgram& program)
+{
+    loadedPrograms.erase(std::remove(loadedPrograms.begin(), loadedPrograms.end(), &program), loadedPrograms.end());
+    glDeleteProgram(program.id);
+    program.id = 0;
+    program.uniforms.clear();
+}
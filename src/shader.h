@@ -0,0 +1,37 @@
+// Shader programs loaded from files in the shader directory. Uniform locations are looked up
+// once per link, linked programs are cached on disk as driver binaries, and programs whose files
+// change are rebuilt while the window runs.
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Holds a linked program and what's needed to build it again
+struct ShaderProgram {
+    GLuint id = 0;
+    std::vector<GLint> uniforms; // Locations in the order the names were given, -1 if unused
+
+    std::string vertexFile, fragmentFile; // Relative to the shader directory
+    std::string defines;                  // Lines inserted after each file's #version
+    std::vector<std::string> uniformNames;
+    void (*onLink)(const ShaderProgram& program) = nullptr; // Sets uniforms that persist, such as samplers
+    std::filesystem::file_time_type vertexTime, fragmentTime;
+};
+
+// Build program from two files, using the binary cache when the sources and driver match.
+// onLink runs with the program bound after every link, including reloads. Needs a current GL
+// context. Returns false, after printing the compile or link log, if the program doesn't build.
+bool loadShaderProgram(ShaderProgram& program, const char* vertexFile, const char* fragmentFile,
+                       const std::vector<std::string>& uniformNames, const std::string& defines = "",
+                       void (*onLink)(const ShaderProgram& program) = nullptr);
+
+// Rebuild the loaded programs whose files changed. A program that fails to build keeps the
+// last one that did, so a typo doesn't take the window down. Returns true if any were rebuilt.
+bool reloadChangedShaders();
+
+// Delete the program and stop watching its files
+void deleteShaderProgram(ShaderProgram& program);
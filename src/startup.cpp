@@ -0,0 +1,27 @@
+// Startup stage timing
+#include "startup.h"
+
+#include <chrono>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+// Taken during static initialisation, before main(), as the closest portable stand-in for process start
+static const Clock::time_point processStart = Clock::now();
+static Clock::time_point lastMark = processStart;
+static float stageMs[startupStageCount] = {};
+
+void finishStartupStage(StartupStage stage)
+{
+    Clock::time_point now = Clock::now();
+    stageMs[stage] = std::chrono::duration<float, std::milli>(now - lastMark).count();
+    lastMark = now;
+}
+
+void printStartupReport()
+{
+    std::printf("Startup:\n");
+    for (int stage = 0; stage < startupStageCount; ++stage)
+        std::printf("  %-12s %8.2f ms\n", startupStageNames[stage], stageMs[stage]);
+    std::printf("First frame on screen after %.2f ms\n", std::chrono::duration<float, std::milli>(lastMark - processStart).count());
+}
@@ -0,0 +1,24 @@
+// Time from process start to the first frame on screen, stage by stage, for --startup-report
+#pragma once
+
+// Startup stages, in the order main() runs them
+enum StartupStage {
+    startupGlfw,       // glfwInit()
+    startupContext,    // Window and GL context creation
+    startupGlad,       // Loading GL function pointers
+    startupShaders,    // Building (or loading cached) shader programs
+    startupMap,        // Doors, shading tables, lightmap, sector world and minimap mesh
+    startupBuffers,    // Vertex arrays, buffers, GPU timers and the pipeline threads
+    startupFirstFrame, // Casting, drawing and presenting the first frame
+    startupStageCount
+};
+
+const char* const startupStageNames[startupStageCount] = {
+    "GLFW init", "context", "GLAD load", "shaders", "map load", "buffers", "first frame"
+};
+
+// Mark stage as finished now; it took the time since the previous mark, or since process start
+void finishStartupStage(StartupStage stage);
+
+// Print each stage's time and the total to the first frame
+void printStartupReport();
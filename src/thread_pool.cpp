@@ -0,0 +1,112 @@
+// Persistent worker threads for splitting per-frame work into bands
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<std::thread> workers;
+static std::mutex poolMutex;
+static std::condition_variable poolWake;  // Workers wait here for a new batch
+static std::condition_variable poolDone;  // parallelFor waits here for the batch to finish
+static const std::function<void(int)>* poolJob = nullptr;
+static int poolCount = 0;
+static std::atomic<int> poolNext{0};      // Next job index to hand out
+static int poolFinished = 0;              // Jobs completed in the current batch
+static int poolActive = 0;                // Workers still inside the current batch
+static unsigned poolGeneration = 0;       // Bumped for every batch so workers see new work
+static bool poolStop = false;
+
+// Claim and run jobs from the current batch until none are left, returning how many ran here
+static int runJobs(const std::function<void(int)>& job, int count)
+{
+    int done = 0;
+    for (int i = poolNext.fetch_add(1); i < count; i = poolNext.fetch_add(1))
+    {
+        PROFILE_ZONE("parallelFor job");
+        job(i);
+        ++done;
+    }
+    return done;
+}
+
+static void workerLoop(int index)
+{
+    profilerThreadName("worker " + std::to_string(index));
+    unsigned seen = 0;
+    while (true)
+    {
+        const std::function<void(int)>* job;
+        int count;
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            poolWake.wait(lock, [&] { return poolStop || poolGeneration != seen; });
+            if (poolStop)
+                return;
+            seen = poolGeneration;
+            if (poolJob == nullptr)
+                continue; // Woke after the batch was already finished
+            job = poolJob;
+            count = poolCount;
+            ++poolActive;
+        }
+
+        int done = runJobs(*job, count);
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        poolFinished += done;
+        --poolActive;
+        poolDone.notify_all();
+    }
+}
+
+int workerCount()
+{
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+void parallelFor(int count, const std::function<void(int)>& job)
+{
+    if (count <= 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (workers.empty()) {
+            poolStop = false;
+            for (int i = 1; i < workerCount(); ++i)
+                workers.emplace_back(workerLoop, i);
+        }
+        poolJob = &job;
+        poolCount = count;
+        poolFinished = 0;
+        poolNext = 0;
+        ++poolGeneration;
+    }
+    poolWake.notify_all();
+
+    // The caller works too, then waits for stragglers. Waiting for every worker to leave
+    // the batch keeps a late worker from claiming indices of the next batch.
+    int done = runJobs(job, count);
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolFinished += done;
+    poolDone.wait(lock, [&] { return poolFinished == count && poolActive == 0; });
+    poolJob = nullptr;
+}
+
+void shutdownWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        poolStop = true;
+    }
+    poolWake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+}
@@ -0,0 +1,14 @@
+// Persistent worker threads for splitting per-frame work into bands
+#pragma once
+
+#include <functional>
+
+// Number of threads that take part in parallelFor(), including the caller
+int workerCount();
+
+// Run job(0) .. job(count - 1) across the workers and the calling thread, returning when all are done.
+// Workers are started on first use.
+void parallelFor(int count, const std::function<void(int)>& job);
+
+// Stop and join the workers
+void shutdownWorkers();
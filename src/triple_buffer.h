@@ -0,0 +1,44 @@
+// Lock-free handoff of the latest value from one producer thread to one consumer thread
+#pragma once
+
+#include <atomic>
+
+// Holds three copies of a value. The producer fills its own slot and swaps it with the shared
+// middle slot; the consumer swaps the middle slot for its own when a fresh value is waiting.
+// Neither side ever waits on the other, and the consumer always reads the newest value published.
+template <typename T>
+struct TripleBuffer {
+    T slots[3];
+
+    // Slot the producer writes next
+    T& writeSlot() { return slots[writeIndex]; }
+
+    // Hand the write slot to the consumer, dropping any value it hasn't taken yet
+    void publish()
+    {
+        int previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    // Take the newest published value into the read slot. Returns false if nothing
+    // was published since the last update, leaving the read slot as it was.
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & freshBit))
+            return false;
+        int previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    // Slot the consumer reads, valid until its next update()
+    const T& readSlot() const { return slots[readIndex]; }
+
+private:
+    static const int indexMask = 3;
+    static const int freshBit = 4;
+
+    std::atomic<int> middle{1}; // Shared slot index, with freshBit set while unread
+    int writeIndex = 0;         // Producer thread only
+    int readIndex = 2;          // Consumer thread only
+};
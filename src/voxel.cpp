@@ -0,0 +1,224 @@
+// Heightmap terrain rendered column by column (Comanche style), using the same player and projection layout
+#include "voxel.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <future>
+#include <mutex>
+
+std::vector<unsigned char> terrainHeight;
+std::vector<unsigned char> terrainColor;
+
+// Terrain deferred by initTerrainLazy(): pending until started, then a generation to wait for
+static std::mutex terrainMutex;
+static bool terrainPending = false;
+static unsigned terrainSeed = 0;
+static std::future<void> terrainGeneration;
+
+// Pseudo-random value in [0, 1) for a lattice point
+static float latticeValue(int x, int y, unsigned seed)
+{
+    unsigned h = seed ^ (static_cast<unsigned>(x) * 374761393u) ^ (static_cast<unsigned>(y) * 668265263u);
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+// Add one octave of smoothly interpolated lattice noise, lattice points every period samples and
+// wrapping at terrainSize, to heights. Lattice values and per-column weights are worked out once
+// per octave rather than per sample.
+static void addNoiseOctave(std::vector<float>& heights, int period, unsigned seed, float amplitude)
+{
+    int cells = terrainSize / period;
+    std::vector<float> lattice(cells * cells);
+    for (int y = 0; y < cells; ++y)
+        for (int x = 0; x < cells; ++x)
+            lattice[y * cells + x] = latticeValue(x, y, seed);
+
+    // Lattice points either side of each position and its smoothstep weight between them,
+    // the same for rows and columns
+    std::vector<int> before(terrainSize), after(terrainSize);
+    std::vector<float> weight(terrainSize);
+    for (int i = 0; i < terrainSize; ++i)
+    {
+        before[i] = i / period % cells;
+        after[i] = (i / period + 1) % cells;
+        float f = static_cast<float>(i % period) / period;
+        weight[i] = f * f * (3.0f - 2.0f * f);
+    }
+
+    for (int y = 0; y < terrainSize; ++y)
+    {
+        const float* row0 = &lattice[before[y] * cells];
+        const float* row1 = &lattice[after[y] * cells];
+        float fy = weight[y];
+        float* out = &heights[y * terrainSize];
+        for (int x = 0; x < terrainSize; ++x)
+        {
+            int x0 = before[x], x1 = after[x];
+            float fx = weight[x];
+            float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+            float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+            out[x] += (top + (bottom - top) * fy) * amplitude;
+        }
+    }
+}
+
+void initTerrain(unsigned seed)
+{
+    const int count = terrainSize * terrainSize;
+    std::vector<float> heights(count);
+
+    // Octaves from broad hills down to small bumps, each half the size and weight of the last
+    float amplitude = 1.0f;
+    for (int period = 256; period >= 8; period /= 2)
+    {
+        addNoiseOctave(heights, period, seed + period, amplitude);
+        amplitude *= 0.5f;
+    }
+    float lowest = *std::min_element(heights.begin(), heights.end());
+    float highest = *std::max_element(heights.begin(), heights.end());
+
+    // Normalise to 0..255 and flood the lowest ground as water
+    const int waterLevel = 70;
+    terrainHeight.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        int h = static_cast<int>((heights[i] - lowest) / (highest - lowest) * 255.0f);
+        terrainHeight[i] = static_cast<unsigned char>(std::max(h, waterLevel));
+    }
+
+    // Colour by height band, shaded by the slope towards the light (from -x)
+    terrainColor.resize(count);
+    for (int y = 0; y < terrainSize; ++y)
+    {
+        for (int x = 0; x < terrainSize; ++x)
+        {
+            int h = terrainHeight[y * terrainSize + x];
+            int west = terrainHeight[y * terrainSize + (x + terrainSize - 1) % terrainSize];
+
+            int ramp;
+            if (h <= waterLevel) ramp = 3;      // Water
+            else if (h < 80) ramp = 6;          // Sand
+            else if (h < 150) ramp = 12;        // Grass
+            else if (h < 200) ramp = 9;         // Rock
+            else ramp = 1;                      // Snow
+
+            int shade = std::clamp(12 + (h - west) * 2, 4, rampShades - 1);
+            terrainColor[y * terrainSize + x] = static_cast<unsigned char>(ramp * rampShades + shade);
+        }
+    }
+}
+
+void initTerrainLazy(unsigned seed)
+{
+    std::lock_guard<std::mutex> lock(terrainMutex);
+    if (terrainGeneration.valid())
+        terrainGeneration.get();
+    terrainSeed = seed;
+    terrainPending = true;
+}
+
+void pregenerateTerrain()
+{
+    std::lock_guard<std::mutex> lock(terrainMutex);
+    if (!terrainPending)
+        return;
+    terrainPending = false;
+    terrainGeneration = std::async(std::launch::async, initTerrain, terrainSeed);
+}
+
+// Make sure deferred terrain exists before it's read
+static void waitForTerrain()
+{
+    std::lock_guard<std::mutex> lock(terrainMutex);
+    if (terrainPending) {
+        terrainPending = false;
+        initTerrain(terrainSeed);
+    } else if (terrainGeneration.valid()) {
+        terrainGeneration.get();
+    }
+}
+
+// March the columns [first, last) front to back into a mesh
+static void renderTerrainColumns(int first, int last, VerticesIndices& mesh)
+{
+    const int mask = terrainSize - 1;
+    const float horizon = projectionHeight / 2.0f;
+    const float heightScale = 240.0f * projectionWidth / (referenceProjectionSize * viewPlaneHalfWidth);
+    const float terrainFog = (lightLevels - 1) / terrainDrawDistance;
+
+    float ivar = float(projectionWidth) / numSlices;
+    float px = playerX * terrainScale;
+    float py = playerY * terrainScale;
+    int groundIndex = (int(std::floor(py)) & mask) * terrainSize + (int(std::floor(px)) & mask);
+    float camHeight = terrainHeight[groundIndex] + terrainEyeHeight;
+    float cosR = std::cos(rotation), sinR = std::sin(rotation);
+
+    for (int column = first; column < last; ++column)
+    {
+        // Unit direction through the column's point on the camera plane
+        float plane = rayPlaneOffset(column);
+        float perpendicular = 1.0f / std::sqrt(1.0f + plane * plane); // Removes fisheye, as in the grid cast
+        float dirX = (cosR - sinR * plane) * perpendicular;
+        float dirY = (sinR + cosR * plane) * perpendicular;
+
+        float lX = projectionToScreenX((int)(column * ivar));
+        float rX = projectionToScreenX((int)((column + 1) * ivar));
+
+        // Highest pixel drawn so far in this column; nearer terrain always wins
+        float yBuffer = 0.0f;
+        // At reduced resolution the march takes proportionally longer steps
+        float dz = float(texSize) / wallRows;
+        for (float z = 1.0f; z < terrainDrawDistance && yBuffer < projectionHeight; z += dz, dz += terrainLod)
+        {
+            int sx = int(std::floor(px + dirX * z)) & mask;
+            int sy = int(std::floor(py + dirY * z)) & mask;
+            int index = sy * terrainSize + sx;
+
+            float top = horizon + (terrainHeight[index] - camHeight) / (z * perpendicular) * heightScale;
+            if (top <= yBuffer)
+                continue;
+            top = std::min(top, float(projectionHeight));
+
+            int level = std::max(0, lightLevels - 1 - static_cast<int>(z * terrainFog));
+            const float* rgb = palette[colormap[level][terrainColor[index]]];
+            appendRect(mesh, lX, rX, projectionToScreenY((int)yBuffer), projectionToScreenY((int)top + 1), rgb);
+            yBuffer = top;
+        }
+    }
+}
+
+VerticesIndices generateTerrainProjection()
+{
+    waitForTerrain();
+    updateColumnTables();
+
+    // A few bands per worker so uneven columns still balance out
+    int bands = std::min(numSlices, workerCount() * 4);
+    std::vector<VerticesIndices> bandMeshes(bands);
+    parallelFor(bands, [&](int band) {
+        int first = numSlices * band / bands;
+        int last = numSlices * (band + 1) / bands;
+        renderTerrainColumns(first, last, bandMeshes[band]);
+    });
+
+    // Stitch the bands together, offsetting each band's indices past the vertices before it
+    VerticesIndices projectionInfo;
+    size_t vertexFloats = 0, indexCount = 0;
+    for (const VerticesIndices& mesh : bandMeshes)
+    {
+        vertexFloats += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
+    projectionInfo.vertices.reserve(vertexFloats);
+    projectionInfo.indices.reserve(indexCount);
+    for (const VerticesIndices& mesh : bandMeshes)
+    {
+        uint vertOffset = projectionInfo.vertices.size() / 6;
+        projectionInfo.vertices.insert(projectionInfo.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        for (uint index : mesh.indices)
+            projectionInfo.indices.push_back(index + vertOffset);
+    }
+    return projectionInfo;
+}
@@ -0,0 +1,28 @@
+// Heightmap terrain rendered column by column (Comanche style), using the same player and projection layout
+#pragma once
+
+#include "raycast.h"
+
+const int terrainSize = 1024;        // Height and colour maps are terrainSize x terrainSize and wrap
+const float terrainScale = 2.0f;     // Terrain samples per world unit
+const float terrainEyeHeight = 40.0f; // Camera height above the ground under the player
+const float terrainDrawDistance = 1200.0f; // Furthest sample marched, in terrain samples
+const float terrainLod = 0.015f;     // Growth of the march step per sample of distance
+
+extern std::vector<unsigned char> terrainHeight; // Height per sample
+extern std::vector<unsigned char> terrainColor;  // Palette index per sample
+
+// Generate the height and colour maps
+void initTerrain(unsigned seed);
+
+// Generate the maps later, so startup doesn't wait for terrain the first frames don't show:
+// on a background thread once pregenerateTerrain() is called, or else on the first
+// generateTerrainProjection(), which also waits for a background generation to finish
+void initTerrainLazy(unsigned seed);
+
+// Start generating terrain deferred by initTerrainLazy() on a background thread
+void pregenerateTerrain();
+
+// Render the terrain into projection rectangles for the right side of the window.
+// Columns are marched front to back with a y-buffer, split into bands across the worker threads.
+VerticesIndices generateTerrainProjection();